@@ -0,0 +1,333 @@
+/*
+ * Lockstep simulation of BATCH_WIDTH independent games (all players
+ * GREEDY) in struct-of-arrays form.
+ *
+ * - Every lane holds one game: positions, targets, turn order, dice
+ *   stream and progress are stored as [...][lane] arrays
+ * - Scalar code: one step advances every active lane by one move (one
+ *   dice roll) in phases over the lanes (roll dice, look up distances &
+ *   path table entries of the candidate moves, then decide). The lookups
+ *   are data-dependent loads that the compiler does not vectorize; the
+ *   phases only issue the loads of independent games back to back, such
+ *   that their cache misses overlap
+ * - Every lane only looks up what its move needs: the way towards the
+ *   Boeg for players chasing it, the distances to the targets for the
+ *   player moving the Boeg
+ * - Path lookups use the per-board tables of GREEDY (see _GreedyBoard)
+ *   instead of walking parent pointers
+ * - Lanes whose game is over write their result and are refilled with the
+ *   next game of the queue; lanes are masked out (skipped) once the queue
+ *   is empty
+ * - Games are set up exactly like GameState_reset (game i from stream
+ *   derive_seed(seed, i)), such that every game has the same result as
+ *   when played by GameState_run; results are written in game order
+ * - The GREEDY rules and book keeping are a second copy of those of
+ *   GameState_move_greedy & GameStepper_record: the throughput tool
+ *   compares both engines game by game on every run
+ * - No Zobrist hashing, no output
+ *
+ * Must be included from game_state.h (needs GREEDY & GameResult_t)
+ */
+
+#pragma once
+#ifndef BATCH_SIM_H
+#define BATCH_SIM_H
+
+#ifndef GAME_STATE_H
+#error "batch_sim.h needs to be included from game_state.h."
+#endif
+
+// Number of games advanced in lockstep
+#ifndef BATCH_WIDTH
+#define BATCH_WIDTH (8)
+#endif
+
+#define BATCH_N_SLOTS (MAX_PLAYERS * N_TARGETS_PLAYER)
+
+// Result of game & turn order it was played in (see SimStats_add)
+typedef struct {
+    GameResult_t result;
+    unsigned int player_order[MAX_PLAYERS];
+} BatchResult_t;
+
+typedef struct {
+    const BoardInfo_t *binfo;
+    const _GreedyBoard *board;
+    unsigned int nPlayers;
+    bool stop_at_first;
+    // Game state (struct of arrays)
+    unsigned int player_pos[MAX_PLAYERS][BATCH_WIDTH];
+    unsigned int targets[BATCH_N_SLOTS][BATCH_WIDTH];
+    unsigned int targets_left[MAX_PLAYERS][BATCH_WIDTH];
+    unsigned int order[MAX_PLAYERS][BATCH_WIDTH];
+    unsigned int boeg_pos[BATCH_WIDTH];
+    unsigned int boeg_id[BATCH_WIDTH];
+    uint64_t dice_state[BATCH_WIDTH];
+    // Progress
+    unsigned int round[BATCH_WIDTH];  // nTurns of GameState_run
+    unsigned int turn[BATCH_WIDTH];   // index into turn order
+    unsigned long game[BATCH_WIDTH];  // index of game (relative to first)
+    bool active[BATCH_WIDTH];
+    GameResult_t result[BATCH_WIDTH];
+    // Scratch of current step
+    unsigned int pid[BATCH_WIDTH];
+    int dice[BATCH_WIDTH];
+    // Player chasing the Boeg
+    int chase_dist[BATCH_WIDTH];           // player -> Boeg
+    unsigned int chase_pos[BATCH_WIDTH];   // player moving towards Boeg
+    // Player moving the Boeg
+    int target_dist[N_TARGETS_PLAYER][BATCH_WIDTH];  // Boeg -> targets
+} BatchSim_t;
+
+// Set up lane for game (like GameState_reset, using gstate as scratch)
+static void _BatchSim_load(BatchSim_t *b, GameState_t *gstate,
+                           unsigned int lane, uint64_t seed,
+                           unsigned long first, unsigned long game)
+{
+    unsigned int i;
+    set_seed(derive_seed(seed, first + game));
+    GameState_reset(gstate, b->binfo->nPositions);
+    for (i = 0; i < b->nPlayers; ++i) {
+        b->player_pos[i][lane] = gstate->player_pos[i];
+        b->targets_left[i][lane] = gstate->player_targets_left[i];
+        b->order[i][lane] = gstate->player_order[i];
+    }
+    for (i = 0; i < b->nPlayers * N_TARGETS_PLAYER; ++i)
+        b->targets[i][lane] = gstate->player_targets[i];
+    b->boeg_pos[lane] = gstate->boeg_pos;
+    b->boeg_id[lane] = gstate->boeg_id;
+    b->dice_state[lane] = gstate->dice_state;
+    b->round[lane] = 1;
+    b->turn[lane] = 0;
+    b->game[lane] = game;
+    b->active[lane] = true;
+    memset(&b->result[lane], 0, sizeof(GameResult_t));
+    b->result[lane].winner = -1;
+}
+
+static inline bool _BatchSim_occupied(const BatchSim_t *b, unsigned int lane,
+                                      unsigned int pos, unsigned int player_id)
+{
+    for (unsigned int j = 0; j < b->nPlayers; ++j) {
+        if (j != player_id && b->targets_left[j][lane] > 0 &&
+                b->player_pos[j][lane] == pos)
+            return true;
+    }
+    return false;
+}
+
+// GREEDY move as Boeg (see GameState_move_greedy)
+static enum STATUS _BatchSim_move_boeg(BatchSim_t *b, unsigned int l,
+                                       unsigned int pid, int dice_roll)
+{
+    const BoardInfo_t *binfo = b->binfo;
+    const unsigned int n = binfo->nPositions;
+    const unsigned int offset_targets = pid * N_TARGETS_PLAYER;
+    unsigned int i, target, min_target = N_TARGETS, closest_pos = n;
+    int dist, min_dist = RAND_MAX;
+
+    for (i = 0; i < N_TARGETS_PLAYER; ++i) {
+        target = b->targets[offset_targets + i][l];
+        if (target == N_TARGETS)
+            continue;
+        dist = b->target_dist[i][l];
+        if (dice_roll >= dist) {
+            if (_BatchSim_occupied(b, l, target, pid))
+                continue;
+            b->boeg_pos[l] = target;
+            b->targets[offset_targets + i][l] = N_TARGETS;
+            return --b->targets_left[pid][l] == 0 ? GAMEOVER : CONTINUE;
+        }
+        if (dist < min_dist) {
+            min_dist = dist;
+            min_target = target;
+        }
+    }
+    if (min_target != N_TARGETS) {
+        closest_pos = _Greedy_toward(binfo, b->board->toward_boeg,
+                                     binfo->dist_boeg, binfo->par_boeg,
+                                     b->boeg_pos[l], min_target, dice_roll);
+    }
+    if (min_target == N_TARGETS || _BatchSim_occupied(b, l, closest_pos, pid)) {
+        // Closest unoccupied position 'dice_roll' steps away (rare)
+        unsigned int k, nReachable;
+        int sum_dists, min_sum = RAND_MAX;
+        const unsigned int *reachable = ReachTable_get(&binfo->reach_boeg,
+                b->boeg_pos[l], dice_roll, &nReachable);
+        closest_pos = n;
+        for (k = 0; k < nReachable; ++k) {
+            const unsigned int j = reachable[k];
+            if (_BatchSim_occupied(b, l, j, pid))
+                continue;
+            sum_dists = 0;
+            for (i = 0; i < N_TARGETS_PLAYER; ++i) {
+                target = b->targets[offset_targets + i][l];
+                if (target != N_TARGETS)
+                    sum_dists += binfo->dist_boeg[j * n + target];
+            }
+            if (sum_dists < min_sum) {
+                min_sum = sum_dists;
+                closest_pos = j;
+            }
+        }
+    }
+    if (closest_pos != n)
+        b->boeg_pos[l] = closest_pos;
+    return CONTINUE;
+}
+
+// GREEDY move chasing the Boeg (see GameState_move_greedy)
+static enum STATUS _BatchSim_move_player(BatchSim_t *b, unsigned int l,
+                                         unsigned int pid, int dice_roll)
+{
+    if (dice_roll >= b->chase_dist[l]) {
+        // Capture
+        const unsigned int pos = b->boeg_pos[l];
+        const unsigned int offset_targets = pid * N_TARGETS_PLAYER;
+        b->player_pos[pid][l] = pos;
+        b->boeg_id[l] = pid;
+        ++b->result[l].captures[pid];
+        for (unsigned int i = 0; i < N_TARGETS_PLAYER; ++i) {
+            const unsigned int target = b->targets[offset_targets + i][l];
+            if (target != N_TARGETS && target == pos) {
+                b->targets[offset_targets + i][l] = N_TARGETS;
+                if (--b->targets_left[pid][l] == 0)
+                    return GAMEOVER;
+                break;
+            }
+        }
+        return AGAIN;
+    }
+    b->player_pos[pid][l] = b->chase_pos[l];
+    return CONTINUE;
+}
+
+// Book keeping after move of lane (see GameState_run); returns true if
+// game is over
+static bool _BatchSim_advance(BatchSim_t *b, unsigned int l, enum STATUS status)
+{
+    GameResult_t *res = &b->result[l];
+    const unsigned int pid = b->pid[l];
+    unsigned int j;
+
+    ++res->nMoves;
+    if (status == AGAIN)
+        return false;  // same player moves again as Boeg
+    if (status == GAMEOVER) {
+        if (res->nRanked == 0) {
+            res->winner = pid;
+            res->winTurn = b->round[l];
+            if (b->stop_at_first) {
+                res->ranking[res->nRanked++] = pid;
+                res->nTurns = b->round[l];
+                return true;
+            }
+        }
+        b->boeg_id[l] = BOEG_ID_DEFAULT;
+        res->ranking[res->nRanked++] = pid;
+        if (res->nRanked == b->nPlayers - 1) {
+            for (j = 0; j < b->nPlayers; ++j) {
+                if (b->targets_left[j][l] > 0) {
+                    res->ranking[res->nRanked++] = j;
+                    break;
+                }
+            }
+            res->nTurns = b->round[l];
+            return true;
+        }
+    }
+    // Next active player in turn order
+    do {
+        if (++b->turn[l] == b->nPlayers) {
+            b->turn[l] = 0;
+            if (++b->round[l] == MAX_TURNS) {
+                res->nTurns = MAX_TURNS;
+                return true;
+            }
+        }
+    } while (b->targets_left[b->order[b->turn[l]][l]][l] == 0);
+    return false;
+}
+
+// Play nGames games (indices first..first + nGames - 1 of seed) with all
+// players GREEDY; result of game first + i is written to results[i].
+// gstate (initialized for nPlayers) is only used to set up games
+void BatchSim_run(const BoardInfo_t *binfo, GameState_t *gstate,
+                  uint64_t seed, unsigned long first, unsigned long nGames,
+                  bool stop_at_first, BatchResult_t *results)
+{
+    const unsigned int n = binfo->nPositions;
+    unsigned int l, i;
+    unsigned long queued = 0;
+    unsigned int nActive = 0;
+
+    BatchSim_t *b = (BatchSim_t *) calloc(1, sizeof(BatchSim_t));
+    assert(b != NULL);
+    b->binfo = binfo;
+    assert(binfo->strategy_board[GREEDY] != NULL);
+    b->board = _Greedy_tables(binfo->strategy_board[GREEDY]);
+    b->nPlayers = gstate->nPlayers;
+    b->stop_at_first = stop_at_first;
+    for (l = 0; l < BATCH_WIDTH; ++l) {
+        b->active[l] = false;
+        if (queued < nGames) {
+            _BatchSim_load(b, gstate, l, seed, first, queued++);
+            ++nActive;
+        }
+    }
+
+    while (nActive > 0) {
+        // Phase 1: player to move & dice of every active lane
+        for (l = 0; l < BATCH_WIDTH; ++l) {
+            if (!b->active[l])
+                continue;
+            b->pid[l] = b->order[b->turn[l]][l];
+            b->dice[l] = (int)(next_r(&b->dice_state[l]) % DIE_SIZE) + 1;
+        }
+        // Phase 2: look up distances of candidate moves
+        for (l = 0; l < BATCH_WIDTH; ++l) {
+            if (!b->active[l])
+                continue;
+            const unsigned int pid = b->pid[l];
+            const unsigned int boeg = b->boeg_pos[l];
+            if (pid == b->boeg_id[l]) {
+                for (i = 0; i < N_TARGETS_PLAYER; ++i) {
+                    // Invalid targets (N_TARGETS) are valid positions as well
+                    const unsigned int target =
+                            b->targets[pid * N_TARGETS_PLAYER + i][l];
+                    b->target_dist[i][l] = binfo->dist_boeg[boeg * n + target];
+                }
+                continue;
+            }
+            const unsigned int pos = b->player_pos[pid][l];
+            b->chase_dist[l] = binfo->dist_player[pos * n + boeg];
+            b->chase_pos[l] = _Greedy_toward(binfo, b->board->toward_player,
+                    binfo->dist_player, binfo->par_player, pos, boeg, b->dice[l]);
+        }
+        // Phase 3: decisions & book keeping
+        for (l = 0; l < BATCH_WIDTH; ++l) {
+            if (!b->active[l])
+                continue;
+            const unsigned int pid = b->pid[l];
+            const enum STATUS status = pid == b->boeg_id[l] ?
+                    _BatchSim_move_boeg(b, l, pid, b->dice[l]) :
+                    _BatchSim_move_player(b, l, pid, b->dice[l]);
+            if (!_BatchSim_advance(b, l, status))
+                continue;
+            // Game over -> write result & refill lane
+            BatchResult_t *out = &results[b->game[l]];
+            out->result = b->result[l];
+            for (i = 0; i < b->nPlayers; ++i)
+                out->player_order[i] = b->order[i][l];
+            b->active[l] = false;
+            --nActive;
+            if (queued < nGames) {
+                _BatchSim_load(b, gstate, l, seed, first, queued++);
+                ++nActive;
+            }
+        }
+    }
+    free(b);
+}
+
+#endif /* BATCH_SIM_H */
@@ -0,0 +1,215 @@
+/*
+ * Checkpoints of long simulation campaigns (see GameState_simulate).
+ *
+ * - A checkpoint holds the accumulated statistics, the number of games
+ *   played and the master seed of the campaign (game i is played from
+ *   derive_seed(seed, i)), such that a resumed run continues the exact
+ *   same sequence of games
+ * - It also identifies the board (hash of its distances; directory for
+ *   messages) and whether EXPECTIMAX estimated leaves by the endgame tables
+ *   (see Expectimax_use_endgame), such that a resumed run plays the same
+ *   games
+ * - Fixed-size binary file (magic, strategies, checksum); written to a
+ *   temporary file, synced and renamed over the previous checkpoint, so a
+ *   crash leaves either the old or the new checkpoint
+ * - Writes happen on a background thread: submitting copies the snapshot
+ *   and returns immediately; if the writer is still busy, only the newest
+ *   pending snapshot is kept
+ *
+ * Must be included from game_state.h (needs SimStats_t)
+ */
+
+#pragma once
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#ifndef GAME_STATE_H
+#error "checkpoint.h needs to be included from game_state.h."
+#endif
+
+#include <stddef.h>  // offsetof
+#include <pthread.h>
+#include <unistd.h>  // fsync
+
+#define CHECKPOINT_MAGIC "FANGCKP3"  // layout of Checkpoint_t & SimStats_t
+#define CHECKPOINT_DIR_LEN (256)
+
+typedef struct {
+    char magic[8];
+    uint32_t nPlayers;
+    uint32_t strategies[MAX_PLAYERS];
+    uint64_t nGames;     // games played so far
+    uint64_t seed;       // master seed of games
+    uint64_t board_hash; // see Checkpoint_board_hash
+    uint32_t endgame_leaf;  // see Expectimax_endgame_leaf
+    char board_dir[CHECKPOINT_DIR_LEN];  // (truncated)
+    SimStats_t stats;
+    uint64_t checksum;   // FNV-1a of all preceding bytes
+} Checkpoint_t;
+
+static uint64_t _Checkpoint_checksum(const Checkpoint_t *ckpt)
+{
+    const unsigned char *bytes = (const unsigned char *) ckpt;
+    uint64_t hash = 0xcbf29ce484222325ULL;  // FNV-1a
+    for (size_t i = 0; i < offsetof(Checkpoint_t, checksum); ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// Identifies board by distances of players & Boeg (independent of the
+// directory it is read from)
+uint64_t Checkpoint_board_hash(const BoardInfo_t *binfo)
+{
+    return _Endgame_board_hash(binfo, false) ^
+           (_Endgame_board_hash(binfo, true) * 0x9e3779b97f4a7c15ULL);
+}
+
+// Snapshot of simulation on board (zero-initialized, such that padding
+// bytes do not affect the checksum)
+void Checkpoint_init(Checkpoint_t *ckpt, const BoardInfo_t *binfo,
+                     const SimStats_t *stats,
+                     const enum MOVE_STRATEGY *player_strategies,
+                     uint64_t nGames, uint64_t seed)
+{
+    memset(ckpt, 0, sizeof(Checkpoint_t));
+    memcpy(ckpt->magic, CHECKPOINT_MAGIC, sizeof(ckpt->magic));
+    ckpt->nPlayers = stats->nPlayers;
+    for (unsigned int i = 0; i < stats->nPlayers; ++i)
+        ckpt->strategies[i] = player_strategies[i];
+    ckpt->nGames = nGames;
+    ckpt->seed = seed;
+    ckpt->board_hash = Checkpoint_board_hash(binfo);
+    ckpt->endgame_leaf = Expectimax_endgame_leaf(binfo);
+    snprintf(ckpt->board_dir, sizeof(ckpt->board_dir), "%s", binfo->board_dir);
+    memcpy(&ckpt->stats, stats, sizeof(SimStats_t));
+    ckpt->checksum = _Checkpoint_checksum(ckpt);
+}
+
+// Atomically replace file at path by checkpoint; returns false on failure
+bool Checkpoint_save(const Checkpoint_t *ckpt, const char *path)
+{
+    char tmp_path[4096];
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >= (int)sizeof(tmp_path))
+        return false;
+    FILE *fp = fopen(tmp_path, "wb");
+    if (fp == NULL)
+        return false;
+    bool ok = fwrite(ckpt, sizeof(Checkpoint_t), 1, fp) == 1 &&
+              fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+    ok = fclose(fp) == 0 && ok;
+    if (!ok || rename(tmp_path, path) != 0) {
+        remove(tmp_path);
+        return false;
+    }
+    return true;
+}
+
+// Load checkpoint; returns false if file is missing, truncated or corrupt
+bool Checkpoint_load(Checkpoint_t *ckpt, const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL)
+        return false;
+    const bool ok = fread(ckpt, sizeof(Checkpoint_t), 1, fp) == 1;
+    fclose(fp);
+    return ok && memcmp(ckpt->magic, CHECKPOINT_MAGIC, sizeof(ckpt->magic)) == 0 &&
+           ckpt->nPlayers <= MAX_PLAYERS &&
+           ckpt->board_dir[CHECKPOINT_DIR_LEN - 1] == '\0' &&
+           ckpt->checksum == _Checkpoint_checksum(ckpt);
+}
+
+// Checkpoint belongs to simulation of given strategies
+bool Checkpoint_matches(const Checkpoint_t *ckpt, unsigned int nPlayers,
+                        const enum MOVE_STRATEGY *player_strategies)
+{
+    if (ckpt->nPlayers != nPlayers || ckpt->stats.nPlayers != nPlayers)
+        return false;
+    for (unsigned int i = 0; i < nPlayers; ++i) {
+        if (ckpt->strategies[i] != (uint32_t)player_strategies[i])
+            return false;
+    }
+    return true;
+}
+
+// Background writer of checkpoints
+typedef struct {
+    const char *path;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    Checkpoint_t pending;
+    bool hasPending;
+    bool shutdown;
+    unsigned long nWritten;
+    unsigned long nFailed;
+} CheckpointWriter;
+
+static void *_CheckpointWriter_run(void *arg)
+{
+    CheckpointWriter *w = (CheckpointWriter *) arg;
+    Checkpoint_t ckpt;
+
+    pthread_mutex_lock(&w->mutex);
+    while (true) {
+        while (!w->hasPending && !w->shutdown)
+            pthread_cond_wait(&w->cond, &w->mutex);
+        if (!w->hasPending)
+            break;  // shutdown & nothing left to write
+        memcpy(&ckpt, &w->pending, sizeof(Checkpoint_t));
+        w->hasPending = false;
+        pthread_mutex_unlock(&w->mutex);
+
+        const bool ok = Checkpoint_save(&ckpt, w->path);
+
+        pthread_mutex_lock(&w->mutex);
+        if (ok) {
+            ++w->nWritten;
+        } else {
+            ++w->nFailed;
+            fprintf(stderr, "Could not write checkpoint '%s'\n", w->path);
+        }
+    }
+    pthread_mutex_unlock(&w->mutex);
+    return NULL;
+}
+
+void CheckpointWriter_init(CheckpointWriter *w, const char *path)
+{
+    w->path = path;
+    w->hasPending = false;
+    w->shutdown = false;
+    w->nWritten = 0;
+    w->nFailed = 0;
+    pthread_mutex_init(&w->mutex, NULL);
+    pthread_cond_init(&w->cond, NULL);
+    if (pthread_create(&w->thread, NULL, _CheckpointWriter_run, w) != 0) {
+        fprintf(stderr, "Could not create checkpoint writer\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Hand snapshot to writer (replaces snapshot not yet written)
+void CheckpointWriter_submit(CheckpointWriter *w, const Checkpoint_t *ckpt)
+{
+    pthread_mutex_lock(&w->mutex);
+    memcpy(&w->pending, ckpt, sizeof(Checkpoint_t));
+    w->hasPending = true;
+    pthread_cond_signal(&w->cond);
+    pthread_mutex_unlock(&w->mutex);
+}
+
+// Write pending snapshot (if any) and stop writer
+void CheckpointWriter_free(CheckpointWriter *w)
+{
+    pthread_mutex_lock(&w->mutex);
+    w->shutdown = true;
+    pthread_cond_signal(&w->cond);
+    pthread_mutex_unlock(&w->mutex);
+    pthread_join(w->thread, NULL);
+    pthread_mutex_destroy(&w->mutex);
+    pthread_cond_destroy(&w->cond);
+}
+
+#endif /* CHECKPOINT_H */
@@ -0,0 +1,494 @@
+/*
+ * Retrograde endgame tables for single-player target collection.
+ *
+ * - For every position and every subset of at most ENDGAME_MAX_TARGETS
+ *   remaining targets, stores the expected number of turns a player
+ *   moving alone on the board needs to visit all targets of the subset
+ *   when playing optimally
+ * - One table per graph (movement of players and of the Boeg); a target
+ *   is visited if it is within reach of the dice roll, otherwise the
+ *   player moves exactly dice roll steps (or stays if it cannot move)
+ * - Built offline (see tools/endgame_gen.c) layer by layer in the number
+ *   of remaining targets: within a layer, every subset is solved
+ *   independently by Gauss-Seidel value iteration over dice outcomes,
+ *   so subsets are distributed among the workers of a thread pool
+ * - Subsets are indexed by their combinatorial (colex) rank within a
+ *   layer; values are stored as fixed-point 16-bit numbers
+ * - Tables are kept in the board context of the ENDGAME strategy (see
+ *   strategy.h) and loaded from the board directory by Endgame_load;
+ *   EXPECTIMAX uses the table of the Boeg as leaf estimate if loaded
+ * - ENDGAME strategy picks the move with least expected number of turns
+ *   by table lookup (as Boeg) or chases the Boeg (otherwise)
+ *
+ * Must be included from game_state.h (needs BoardInfo_t & GameState_t)
+ */
+
+#pragma once
+#ifndef ENDGAME_H
+#define ENDGAME_H
+
+#ifndef GAME_STATE_H
+#error "endgame.h needs to be included from game_state.h."
+#endif
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "thread_pool.h"
+
+#define ENDGAME_MAX_TARGETS (N_TARGETS_PLAYER)
+// Fixed-point scale of stored values (1/ENDGAME_SCALE turns)
+#define ENDGAME_SCALE (256.0)
+#define ENDGAME_UNREACHABLE (UINT16_MAX)
+// Convergence threshold of value iteration (turns)
+#define ENDGAME_EPS (1e-4)
+#define ENDGAME_MAX_SWEEPS (10000)
+// Subsets claimed by a worker at once
+#define ENDGAME_CHUNK (16)
+
+#define ENDGAME_MAGIC "FANGEGT1"
+// Files of tables within board directory
+#define ENDGAME_BOEG_FILE "endgame_boeg.bin"
+#define ENDGAME_PLAYER_FILE "endgame_player.bin"
+
+typedef struct {
+    char magic[8];
+    uint32_t nPositions;
+    uint32_t nTargets;
+    uint32_t maxTargets;
+    uint32_t isBoeg;
+    uint64_t board_hash;  // identifies distances the table was built from
+} EndgameHeader;
+
+typedef struct {
+    uint16_t *values;  // (subset offset + rank) * nPositions + position
+    unsigned int nPositions;
+    bool isBoeg;
+    uint64_t board_hash;
+    // Binomial coefficients & offset of every layer
+    size_t binom[N_TARGETS + 1][ENDGAME_MAX_TARGETS + 1];
+    size_t offsets[ENDGAME_MAX_TARGETS + 2];
+} EndgameTable;
+
+// Board context of ENDGAME: tables of both graphs (once loaded)
+typedef struct {
+    EndgameTable boeg, player;
+    bool loaded;
+} _EndgameBoard;
+
+// Hash of the distance matrix of a graph
+uint64_t _Endgame_board_hash(const BoardInfo_t *binfo, bool isBoeg)
+{
+    const int *dist = isBoeg ? binfo->dist_boeg : binfo->dist_player;
+    const size_t n = (size_t)binfo->nPositions * binfo->nPositions;
+    uint64_t hash = 0xcbf29ce484222325ULL;  // FNV-1a
+    for (size_t i = 0; i < n; ++i) {
+        hash ^= (uint32_t)dist[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+void _EndgameTable_setup(EndgameTable *et, unsigned int nPositions, bool isBoeg)
+{
+    unsigned int n, k;
+    et->nPositions = nPositions;
+    et->isBoeg = isBoeg;
+    for (n = 0; n <= N_TARGETS; ++n) {
+        et->binom[n][0] = 1;
+        for (k = 1; k <= ENDGAME_MAX_TARGETS; ++k) {
+            et->binom[n][k] = n == 0 ? 0 : et->binom[n-1][k-1] + et->binom[n-1][k];
+        }
+    }
+    // Empty subset is not stored (no turns left)
+    et->offsets[1] = 0;
+    for (k = 1; k <= ENDGAME_MAX_TARGETS; ++k) {
+        et->offsets[k + 1] = et->offsets[k] + et->binom[N_TARGETS][k];
+    }
+    et->values = (uint16_t *) malloc(et->offsets[ENDGAME_MAX_TARGETS + 1] *
+                                     nPositions * sizeof(uint16_t));
+    assert(et->values != NULL);
+}
+
+// Rank of subset of k targets sorted in ascending order
+static inline size_t _Endgame_rank(const EndgameTable *et,
+                                   const unsigned int *subset, unsigned int k)
+{
+    size_t rank = 0;
+    for (unsigned int i = 0; i < k; ++i)
+        rank += et->binom[subset[i]][i + 1];
+    return rank;
+}
+
+// Inverse of _Endgame_rank
+static void _Endgame_unrank(const EndgameTable *et, size_t rank,
+                            unsigned int k, unsigned int *subset)
+{
+    unsigned int c = N_TARGETS;
+    for (unsigned int i = k; i-- > 0;) {
+        while (et->binom[c][i + 1] > rank)
+            --c;
+        subset[i] = c;
+        rank -= et->binom[c][i + 1];
+    }
+}
+
+static inline double _Endgame_decode(uint16_t value)
+{
+    return value == ENDGAME_UNREACHABLE ? INFINITY : value / ENDGAME_SCALE;
+}
+
+// Stored value of sorted subset of k targets
+static inline double _Endgame_lookup(const EndgameTable *et, unsigned int pos,
+                                     const unsigned int *subset, unsigned int k)
+{
+    if (k == 0)
+        return 0.0;
+    const size_t index = et->offsets[k] + _Endgame_rank(et, subset, k);
+    return _Endgame_decode(et->values[index * et->nPositions + pos]);
+}
+
+// Expected number of turns to visit all given targets (entries equal
+// to N_TARGETS are skipped) starting from pos
+double EndgameTable_value(const EndgameTable *et, unsigned int pos,
+                          const unsigned int *targets, unsigned int nTargets)
+{
+    unsigned int subset[ENDGAME_MAX_TARGETS];
+    unsigned int i, j, k = 0, t;
+    for (i = 0; i < nTargets; ++i) {
+        t = targets[i];
+        if (t == N_TARGETS)
+            continue;
+        assert(t < N_TARGETS && k < ENDGAME_MAX_TARGETS);
+        // Insertion sort
+        for (j = k++; j > 0 && subset[j-1] > t; --j)
+            subset[j] = subset[j-1];
+        subset[j] = t;
+    }
+    return _Endgame_lookup(et, pos, subset, k);
+}
+
+typedef struct {
+    EndgameTable *et;
+    const BoardInfo_t *binfo;
+    unsigned int layer;
+    atomic_size_t next;  // next subset (rank) to be claimed
+} _EndgameBuild;
+
+// Solve all positions of one subset of the current layer
+static void _Endgame_solve(_EndgameBuild *b, size_t rank, double *V)
+{
+    EndgameTable *et = b->et;
+    const BoardInfo_t *binfo = b->binfo;
+    const unsigned int n = binfo->nPositions;
+    const unsigned int k = b->layer;
+    const int *dist = et->isBoeg ? binfo->dist_boeg : binfo->dist_player;
+    const ReachTable *rt = et->isBoeg ? &binfo->reach_boeg : &binfo->reach_player;
+    unsigned int subset[ENDGAME_MAX_TARGETS], rest[ENDGAME_MAX_TARGETS];
+    double visit[ENDGAME_MAX_TARGETS];  // value after visiting target
+    unsigned int i, j, m, p, nReachable, nStay;
+    const unsigned int *reachable;
+
+    _Endgame_unrank(et, rank, k, subset);
+    for (i = 0; i < k; ++i) {
+        for (j = 0, m = 0; j < k; ++j) {
+            if (j != i)
+                rest[m++] = subset[j];
+        }
+        visit[i] = _Endgame_lookup(et, subset[i], rest, k - 1);
+    }
+
+    for (p = 0; p < n; ++p)
+        V[p] = 0.0;
+    // Gauss-Seidel value iteration (monotonically increasing from 0)
+    double delta = INFINITY;
+    for (unsigned int sweep = 0; sweep < ENDGAME_MAX_SWEEPS && delta > ENDGAME_EPS; ++sweep) {
+        delta = 0.0;
+        for (p = 0; p < n; ++p) {
+            double sum = 0.0;
+            nStay = 0;
+            for (int d = 1; d <= DIE_SIZE; ++d) {
+                double best = INFINITY;
+                // Visit target within reach
+                for (i = 0; i < k; ++i) {
+                    const int dt = dist[p * n + subset[i]];
+                    if (0 <= dt && dt <= d && visit[i] < best)
+                        best = visit[i];
+                }
+                // Move exactly d steps
+                reachable = ReachTable_get(rt, p, d, &nReachable);
+                for (j = 0; j < nReachable; ++j) {
+                    if (V[reachable[j]] < best)
+                        best = V[reachable[j]];
+                }
+                if (nReachable == 0 && best == INFINITY)
+                    ++nStay;  // stays at p
+                else
+                    sum += best;
+            }
+            // V = 1 + (sum + nStay * V) / DIE_SIZE
+            double value = nStay == DIE_SIZE ? INFINITY :
+                    (DIE_SIZE + sum) / (DIE_SIZE - nStay);
+            // Positions from which subset cannot be visited diverge
+            if (value >= ENDGAME_UNREACHABLE / ENDGAME_SCALE)
+                value = INFINITY;
+            if (value != V[p]) {
+                const double diff = isinf(value) ? INFINITY : value - V[p];
+                if (diff > delta)
+                    delta = diff;
+                V[p] = value;
+            }
+        }
+    }
+
+    uint16_t *out = &et->values[(et->offsets[k] + rank) * n];
+    for (p = 0; p < n; ++p) {
+        const double scaled = V[p] * ENDGAME_SCALE + 0.5;
+        out[p] = scaled >= ENDGAME_UNREACHABLE ? ENDGAME_UNREACHABLE : (uint16_t)scaled;
+    }
+}
+
+static void _Endgame_worker(void *arg, unsigned int worker_id)
+{
+    (void) worker_id;
+    _EndgameBuild *b = (_EndgameBuild *) arg;
+    const size_t nSubsets = b->et->binom[N_TARGETS][b->layer];
+    double *V = (double *) malloc(b->binfo->nPositions * sizeof(double));
+    assert(V != NULL);
+
+    size_t start, rank;
+    while ((start = atomic_fetch_add(&b->next, ENDGAME_CHUNK)) < nSubsets) {
+        for (rank = start; rank < start + ENDGAME_CHUNK && rank < nSubsets; ++rank)
+            _Endgame_solve(b, rank, V);
+    }
+    free(V);
+}
+
+// Compute table for movement of players or Boeg using given thread pool
+void EndgameTable_build(EndgameTable *et, const BoardInfo_t *binfo,
+                        bool isBoeg, ThreadPool *pool)
+{
+    _EndgameTable_setup(et, binfo->nPositions, isBoeg);
+    et->board_hash = _Endgame_board_hash(binfo, isBoeg);
+
+    _EndgameBuild b;
+    b.et = et;
+    b.binfo = binfo;
+    // Layers depend on previous layer only
+    for (b.layer = 1; b.layer <= ENDGAME_MAX_TARGETS; ++b.layer) {
+        atomic_init(&b.next, 0);
+        ThreadPool_run(pool, _Endgame_worker, &b);
+    }
+}
+
+void EndgameTable_save(const EndgameTable *et, const char *path)
+{
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) {
+        fprintf(stderr, "Could not open '%s' for writing\n", path);
+        exit(EXIT_FAILURE);
+    }
+    EndgameHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ENDGAME_MAGIC, sizeof(header.magic));
+    header.nPositions = et->nPositions;
+    header.nTargets = N_TARGETS;
+    header.maxTargets = ENDGAME_MAX_TARGETS;
+    header.isBoeg = et->isBoeg;
+    header.board_hash = et->board_hash;
+
+    const size_t nValues = et->offsets[ENDGAME_MAX_TARGETS + 1] * et->nPositions;
+    if (fwrite(&header, sizeof(header), 1, fp) != 1 ||
+        fwrite(et->values, sizeof(uint16_t), nValues, fp) != nValues) {
+        fprintf(stderr, "Could not write '%s'\n", path);
+        exit(EXIT_FAILURE);
+    }
+    fclose(fp);
+}
+
+// Load table from file; returns false if file is missing or was built
+// for a different board
+bool EndgameTable_load(EndgameTable *et, const BoardInfo_t *binfo,
+                       bool isBoeg, const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL)
+        return false;
+
+    EndgameHeader header;
+    if (fread(&header, sizeof(header), 1, fp) != 1 ||
+        memcmp(header.magic, ENDGAME_MAGIC, sizeof(header.magic)) != 0 ||
+        header.nPositions != binfo->nPositions ||
+        header.nTargets != N_TARGETS ||
+        header.maxTargets != ENDGAME_MAX_TARGETS ||
+        header.isBoeg != isBoeg ||
+        header.board_hash != _Endgame_board_hash(binfo, isBoeg)) {
+        fclose(fp);
+        return false;
+    }
+    _EndgameTable_setup(et, binfo->nPositions, isBoeg);
+    et->board_hash = header.board_hash;
+    const size_t nValues = et->offsets[ENDGAME_MAX_TARGETS + 1] * et->nPositions;
+    if (fread(et->values, sizeof(uint16_t), nValues, fp) != nValues) {
+        free(et->values);
+        fclose(fp);
+        return false;
+    }
+    fclose(fp);
+    return true;
+}
+
+void EndgameTable_free(EndgameTable *et)
+{
+    free(et->values);
+    et->values = NULL;
+}
+
+// Path of table of graph in directory of board
+void Endgame_path(const BoardInfo_t *binfo, bool isBoeg, char *path, size_t size)
+{
+    snprintf(path, size, "%s/%s", binfo->board_dir,
+             isBoeg ? ENDGAME_BOEG_FILE : ENDGAME_PLAYER_FILE);
+}
+
+static void *_Endgame_board_init(const BoardInfo_t *binfo)
+{
+    (void) binfo;
+    _EndgameBoard *board = (_EndgameBoard *) calloc(1, sizeof(_EndgameBoard));
+    assert(board != NULL);
+    return board;
+}
+
+static void _Endgame_board_free(void *ctx)
+{
+    _EndgameBoard *board = (_EndgameBoard *) ctx;
+    if (board->loaded) {
+        EndgameTable_free(&board->boeg);
+        EndgameTable_free(&board->player);
+    }
+    free(board);
+}
+
+// Load tables of both graphs from directory of board (into context of
+// ENDGAME); returns true if both were found and match the board. Must be
+// called before any game is played on the board
+bool Endgame_load(BoardInfo_t *binfo)
+{
+    BoardInfo_wait(binfo);  // tables are checked against distances
+    _EndgameBoard *board = (_EndgameBoard *) binfo->strategy_board[ENDGAME];
+    if (board->loaded)
+        return true;
+    char path[4096];
+    Endgame_path(binfo, true, path, sizeof(path));
+    if (!EndgameTable_load(&board->boeg, binfo, true, path))
+        return false;
+    Endgame_path(binfo, false, path, sizeof(path));
+    if (!EndgameTable_load(&board->player, binfo, false, path)) {
+        EndgameTable_free(&board->boeg);
+        return false;
+    }
+    board->loaded = true;
+    return true;
+}
+
+// Table of the Boeg if loaded (NULL otherwise)
+const EndgameTable *Endgame_boeg_table(const BoardInfo_t *binfo)
+{
+    const _EndgameBoard *board = (const _EndgameBoard *) binfo->strategy_board[ENDGAME];
+    return board->loaded ? &board->boeg : NULL;
+}
+
+// Expected number of turns left for player after moving to destination
+static double _Endgame_move_value(const BoardInfo_t *binfo,
+                                  const _EndgameBoard *board,
+                                  const GameState_t *gstate,
+                                  unsigned int player_id,
+                                  unsigned int destination, int dice_roll)
+{
+    const unsigned int *player_targets =
+            &gstate->player_targets[player_id * N_TARGETS_PLAYER];
+    unsigned int targets[N_TARGETS_PLAYER];
+    unsigned int i;
+    int dist;
+    memcpy(targets, player_targets, sizeof(targets));
+
+    if (player_id == gstate->boeg_id) {
+        for (i = 0; i < N_TARGETS_PLAYER; ++i) {
+            if (targets[i] == N_TARGETS)
+                continue;
+            dist = binfo->dist_boeg[gstate->boeg_pos * binfo->nPositions + targets[i]];
+            if (targets[i] == destination && dice_roll >= dist) {
+                targets[i] = N_TARGETS;  // visited
+                break;
+            }
+        }
+        return EndgameTable_value(&board->boeg, destination, targets, N_TARGETS_PLAYER);
+    }
+
+    const unsigned int boeg_pos = gstate->boeg_pos;
+    // Targets left once Boeg is captured
+    for (i = 0; i < N_TARGETS_PLAYER; ++i) {
+        if (targets[i] == boeg_pos)
+            targets[i] = N_TARGETS;
+    }
+    const double boeg_value = EndgameTable_value(&board->boeg, boeg_pos, targets,
+                                                 N_TARGETS_PLAYER);
+    if (destination == boeg_pos)  // capture
+        return boeg_value;
+    // Turns needed to catch (stationary) Boeg
+    double chase;
+    if (boeg_pos < N_TARGETS) {
+        chase = EndgameTable_value(&board->player, destination, &boeg_pos, 1);
+    } else {
+        dist = binfo->dist_player[destination * binfo->nPositions + boeg_pos];
+        chase = dist < 0 ? INFINITY : dist / ((DIE_SIZE + 1) / 2.0);
+    }
+    return chase + boeg_value;
+}
+
+// ENDGAME STRATEGY:
+// Move to destination with least expected number of turns left according
+// to the endgame tables (opponents are ignored)
+enum STATUS GameState_move_endgame(const BoardInfo_t *binfo,
+            const StrategyCtx_t *ctx, GameState_t *gstate,
+            unsigned int player_id, const AvoidParams_t *params, bool verbose) {
+    const _EndgameBoard *board = (const _EndgameBoard *) ctx->board;
+    (void) params;
+    if (!board->loaded) {
+        fprintf(stderr, "Endgame tables not loaded (run 'make endgame')\n");
+        exit(EXIT_FAILURE);
+    }
+    // Roll dice
+    int dice_roll = roll_dice(gstate);
+    if (verbose)
+        printf("\n%sDice Roll: %d%s\n\n", PLAYER_COLORS[player_id],
+            dice_roll, DEFAULT_COLOR);
+
+    unsigned int *moves = gstate->moves_buf;
+    const unsigned int nMoves = GameState_legal_moves(binfo, gstate, player_id,
+                                                      dice_roll, moves);
+    unsigned int i, best_pos = moves[0];
+    double value, best = INFINITY;
+    for (i = 0; i < nMoves; ++i) {
+        value = _Endgame_move_value(binfo, board, gstate, player_id, moves[i],
+                                    dice_roll);
+        if (value < best) {
+            best = value;
+            best_pos = moves[i];
+        }
+    }
+    if (verbose)
+        printf("Endgame: expected turns left: %.2f\n", best);
+    return GameState_apply_move(binfo, gstate, player_id, best_pos, dice_roll);
+}
+
+static const Strategy_t STRATEGY_ENDGAME = {
+    .name = "ENDGAME",
+    .init = _Endgame_board_init,
+    .free = _Endgame_board_free,
+    .thread_init = NULL,
+    .thread_free = NULL,
+    .move = GameState_move_endgame
+};
+
+#endif /* ENDGAME_H */
@@ -0,0 +1,544 @@
+/*
+ * Depth-limited expectimax strategy over dice outcomes.
+ *
+ * - Values are expected number of turns left until the player has
+ *   visited all of its targets (lower is better)
+ * - Chance nodes enumerate all DIE_SIZE dice outcomes, decision nodes
+ *   all legal destinations for the rolled value
+ * - Capturing the Boeg is followed by another move as Boeg in the
+ *   same turn
+ * - As Boeg, every position carries the risk of being captured by one of
+ *   the opponents within their next dice roll
+ * - Opponents are assumed to stay where they are for the duration of the
+ *   search; since the Boeg moves on in between turns, positions while
+ *   chasing it are evaluated by the heuristic directly
+ * - Leaves are evaluated by the threat of opponents (as in AVOIDANT) plus
+ *   a nearest-neighbor tour over the remaining targets, or the expected
+ *   number of turns from the endgame table of the Boeg if explicitly
+ *   requested (Expectimax_use_endgame); whether the tables merely exist
+ *   never changes moves
+ * - Iterative deepening up to EXPECTIMAX_MAX_DEPTH, bounded by a fixed
+ *   node (and optionally time) budget per move; the best move of the
+ *   deepest completed iteration is played
+ * - Transposition table entries are keyed on the Zobrist hash of the game
+ *   state at the node (see zobrist.h): the search starts from the hash of
+ *   the game state and updates it in O(1) along every move (Boeg position,
+ *   owner & visited targets), such that all move orders reaching the same
+ *   state share one entry. Depth and the inputs that are not part of the
+ *   state (player, objective, leaf estimate) are mixed into the key
+ * - Every game state owns its transposition table (strategy thread
+ *   context), allocated on its first move; no allocations inside the
+ *   search. Every search keys its entries on a new generation, such that
+ *   a move never depends on earlier moves, games or other threads. The
+ *   (lock-free) table is deliberately not shared between threads: hits
+ *   from other searches would save nodes of the budget depending on
+ *   scheduling, and results would depend on the number of threads
+ *
+ * Must be included from game_state.h (needs BoardInfo_t & GameState_t)
+ */
+
+#pragma once
+#ifndef EXPECTIMAX_H
+#define EXPECTIMAX_H
+
+#ifndef GAME_STATE_H
+#error "expectimax.h needs to be included from game_state.h."
+#endif
+
+#include <stdint.h>
+#include <time.h>  // clock_gettime
+
+#include "ttable.h"
+
+#ifndef EXPECTIMAX_MAX_DEPTH
+#define EXPECTIMAX_MAX_DEPTH (3)
+#endif
+// Maximum number of chance nodes expanded per move
+#ifndef EXPECTIMAX_NODE_BUDGET
+#define EXPECTIMAX_NODE_BUDGET (200000)
+#endif
+// Maximum time spent per move in microseconds (0: no time limit)
+#ifndef EXPECTIMAX_TIME_BUDGET_US
+#define EXPECTIMAX_TIME_BUDGET_US (0)
+#endif
+// Expected number of turns lost when captured as Boeg
+#ifndef EXPECTIMAX_CAPTURE_PENALTY
+#define EXPECTIMAX_CAPTURE_PENALTY (3.0)
+#endif
+// Number of transposition table entries (power of 2)
+#define EXPECTIMAX_TT_BITS (16)
+// Check clock every so many nodes
+#define EXPECTIMAX_CLOCK_INTERVAL (256)
+
+#define EM_MEAN_ROLL ((DIE_SIZE + 1) / 2.0)
+#define EM_UNREACHABLE (MAX_TURNS)
+
+// Static information shared by all nodes of one search
+typedef struct {
+    const BoardInfo_t *binfo;
+    unsigned int targets[N_TARGETS_PLAYER];  // target slots of player
+    unsigned int opp_pos[MAX_PLAYERS];       // positions of active opponents
+    unsigned int nOpp;
+    unsigned int boeg_pos;                   // position of Boeg at root
+    unsigned int boeg_id;                    // owner of Boeg at root
+    unsigned int player_id;
+    unsigned int home_pos;                   // position returned to if captured
+    AvoidParams_t params;                    // weights of opponent threat
+    const EndgameTable *endgame;             // of Boeg (NULL: tour as leaf)
+    uint64_t salt;                           // hash of inputs besides state
+    TTable *table;                           // of game state
+    unsigned long nodes;
+    struct timespec start;
+    bool aborted;
+} _EMSearch;
+
+// Board context: leaf estimate
+typedef struct {
+    bool endgame_leaf;        // endgame table of Boeg instead of tour
+} _EMBoard;
+
+// Thread context: transposition table & number of searches so far
+typedef struct {
+    TTable table;
+    uint64_t generation;
+} _EMContext;
+
+// Finalizer of splitmix64
+static inline uint64_t _EM_mix(uint64_t z)
+{
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
+
+static inline bool _EM_occupied(const _EMSearch *s, unsigned int pos)
+{
+    for (unsigned int i = 0; i < s->nOpp; ++i) {
+        if (s->opp_pos[i] == pos)
+            return true;
+    }
+    return false;
+}
+
+// Hash of state after Boeg moved from pos to dest, where the targets of
+// mask that are not in dest_mask were visited
+static inline uint64_t _EM_hash_boeg(const _EMSearch *s, uint64_t hash,
+                                     unsigned int pos, unsigned int dest,
+                                     unsigned int mask, unsigned int dest_mask)
+{
+    hash ^= Zobrist_key(ZOBRIST_BOEG_POS, 0, pos) ^
+            Zobrist_key(ZOBRIST_BOEG_POS, 0, dest);
+    for (unsigned int cleared = mask & ~dest_mask; cleared; cleared &= cleared - 1) {
+        const unsigned int i = __builtin_ctz(cleared);
+        hash ^= Zobrist_key(ZOBRIST_TARGET,
+                            s->player_id * N_TARGETS_PLAYER + i, s->targets[i]);
+    }
+    return hash;
+}
+
+// Remove target slot at pos from mask (if any)
+static inline unsigned int _EM_visit(const _EMSearch *s, unsigned int pos,
+                                     unsigned int mask)
+{
+    for (unsigned int i = 0; i < N_TARGETS_PLAYER; ++i) {
+        if ((mask & (1u << i)) && s->targets[i] == pos)
+            return mask & ~(1u << i);
+    }
+    return mask;
+}
+
+// Probability that at least one opponent captures the Boeg at pos
+// within its next dice roll
+static double _EM_risk(const _EMSearch *s, unsigned int pos)
+{
+    const unsigned int n = s->binfo->nPositions;
+    double p_safe = 1.0;
+    for (unsigned int i = 0; i < s->nOpp; ++i) {
+        int dist = s->binfo->dist_player[s->opp_pos[i] * n + pos];
+        if (0 < dist && dist <= DIE_SIZE) {
+            // Any dice roll of at least dist captures
+            p_safe *= (double)(dist - 1) / DIE_SIZE;
+        }
+    }
+    return 1.0 - p_safe;
+}
+
+// Threat of opponents to the Boeg at pos, weighted like the objective
+// of the AVOIDANT strategy
+static double _EM_threat(const _EMSearch *s, unsigned int pos, unsigned int mask)
+{
+    const unsigned int n = s->binfo->nPositions;
+    const double avoidance = s->params.base_avoidance *
+            __builtin_popcount(mask) / N_TARGETS_PLAYER;
+    double threat = 0.0;
+    for (unsigned int i = 0; i < s->nOpp; ++i) {
+        int dist = s->binfo->dist_player[s->opp_pos[i] * n + pos];
+        if (dist <= 0)
+            continue;
+        // Lessen penalty if opponent cannot reach within one dice roll
+        threat += avoidance / (dist > DIE_SIZE ? s->params.far_factor * dist : dist);
+    }
+    return threat;
+}
+
+// Heuristic estimate of turns left: threat of opponents plus
+// nearest-neighbor tour over all remaining targets (after catching the
+// Boeg, if not already the Boeg); the tour is replaced by the endgame
+// table of the Boeg if loaded
+static double _EM_leaf(const _EMSearch *s, unsigned int pos,
+                       unsigned int mask, bool isBoeg)
+{
+    const BoardInfo_t *binfo = s->binfo;
+    const unsigned int n = binfo->nPositions;
+    double steps = 0.0;
+
+    if (!isBoeg) {
+        int dist = binfo->dist_player[pos * n + s->boeg_pos];
+        steps += dist >= 0 ? dist : EM_UNREACHABLE;
+        pos = s->boeg_pos;
+        mask = _EM_visit(s, pos, mask);
+    }
+    steps += _EM_threat(s, pos, mask);
+    // Exact single-player estimate of remaining tour, if available
+    if (s->endgame != NULL) {
+        unsigned int targets[N_TARGETS_PLAYER];
+        for (unsigned int i = 0; i < N_TARGETS_PLAYER; ++i)
+            targets[i] = (mask & (1u << i)) ? s->targets[i] : N_TARGETS;
+        const double tour = EndgameTable_value(s->endgame, pos, targets,
+                                               N_TARGETS_PLAYER);
+        return steps / EM_MEAN_ROLL + (isinf(tour) ? EM_UNREACHABLE : tour);
+    }
+    while (mask) {
+        unsigned int i, closest = 0;
+        int dist, min_dist = RAND_MAX;
+        for (i = 0; i < N_TARGETS_PLAYER; ++i) {
+            if (!(mask & (1u << i)))
+                continue;
+            dist = binfo->dist_boeg[pos * n + s->targets[i]];
+            if (dist < 0)
+                dist = EM_UNREACHABLE;
+            if (dist < min_dist) {
+                min_dist = dist;
+                closest = i;
+            }
+        }
+        steps += min_dist;
+        pos = s->targets[closest];
+        mask &= ~(1u << closest);
+    }
+    return steps / EM_MEAN_ROLL;
+}
+
+static bool _EM_out_of_budget(_EMSearch *s)
+{
+    if (s->nodes >= EXPECTIMAX_NODE_BUDGET)
+        return true;
+#if EXPECTIMAX_TIME_BUDGET_US > 0
+    if (s->nodes % EXPECTIMAX_CLOCK_INTERVAL == 0) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long elapsed_us = (now.tv_sec - s->start.tv_sec) * 1000000L +
+                          (now.tv_nsec - s->start.tv_nsec) / 1000L;
+        if (elapsed_us >= EXPECTIMAX_TIME_BUDGET_US)
+            return true;
+    }
+#endif
+    return false;
+}
+
+static double _EM_chance(_EMSearch *, unsigned int, unsigned int, bool,
+                         unsigned int, uint64_t);
+
+// Expected turns left after moving to pos (hash of state after the move)
+static double _EM_value(_EMSearch *s, unsigned int pos, unsigned int mask,
+                        bool isBoeg, unsigned int depth, uint64_t hash)
+{
+    if (mask == 0)
+        return 0.0;  // finished
+
+    // Boeg moves on in between turns; no lookahead while chasing it
+    if (!isBoeg)
+        return 1.0 + _EM_leaf(s, pos, mask, false);
+
+    double cont = depth > 1 ? _EM_chance(s, pos, mask, true, depth - 1, hash)
+                            : _EM_leaf(s, pos, mask, true);
+    const double risk = _EM_risk(s, pos);
+    // If captured, player is sent back to its own position
+    return 1.0 + risk * (EXPECTIMAX_CAPTURE_PENALTY +
+                         _EM_leaf(s, s->home_pos, mask, false)) +
+           (1.0 - risk) * cont;
+}
+
+// Best destination for given dice roll (hash of state at pos); minimum
+// expected turns left is returned and the corresponding destination
+// written to best_pos
+static double _EM_decision(_EMSearch *s, unsigned int pos, unsigned int mask,
+                           bool isBoeg, int dice_roll, unsigned int depth,
+                           uint64_t hash, unsigned int *best_pos)
+{
+    const BoardInfo_t *binfo = s->binfo;
+    const unsigned int n = binfo->nPositions;
+    double value, best = INFINITY;
+    unsigned int i, u, dest_mask, nReachable;
+    const unsigned int *reachable;
+    int dist;
+
+    *best_pos = pos;
+    if (isBoeg) {
+        // Remaining targets within reach
+        for (i = 0; i < N_TARGETS_PLAYER; ++i) {
+            if (!(mask & (1u << i)))
+                continue;
+            u = s->targets[i];
+            dist = binfo->dist_boeg[pos * n + u];
+            if (dist < 0 || dice_roll < dist || _EM_occupied(s, u))
+                continue;
+            dest_mask = mask & ~(1u << i);
+            value = _EM_value(s, u, dest_mask, true, depth,
+                              _EM_hash_boeg(s, hash, pos, u, mask, dest_mask));
+            if (value < best) {
+                best = value;
+                *best_pos = u;
+            }
+        }
+        // Like the heuristic strategies, always visit a target if possible
+        if (best != INFINITY)
+            return best;
+        // Unoccupied positions exactly dice_roll steps away
+        reachable = ReachTable_get(&binfo->reach_boeg, pos, dice_roll, &nReachable);
+        for (i = 0; i < nReachable; ++i) {
+            u = reachable[i];
+            if (_EM_occupied(s, u))
+                continue;
+            dest_mask = _EM_visit(s, u, mask);
+            value = _EM_value(s, u, dest_mask, true, depth,
+                              _EM_hash_boeg(s, hash, pos, u, mask, dest_mask));
+            if (value < best) {
+                best = value;
+                *best_pos = u;
+            }
+        }
+    } else {
+        // Capture Boeg if within reach and move again right away
+        dist = binfo->dist_player[pos * n + s->boeg_pos];
+        if (dist >= 0 && dice_roll >= dist) {
+            const unsigned int mask_capture = _EM_visit(s, s->boeg_pos, mask);
+            // Player moves onto the Boeg & takes it over (Boeg stays)
+            const uint64_t hash_capture = _EM_hash_boeg(s,
+                    hash ^ Zobrist_key(ZOBRIST_PLAYER_POS, s->player_id, pos) ^
+                    Zobrist_key(ZOBRIST_PLAYER_POS, s->player_id, s->boeg_pos) ^
+                    Zobrist_key(ZOBRIST_BOEG_ID, 0, s->boeg_id) ^
+                    Zobrist_key(ZOBRIST_BOEG_ID, 0, s->player_id),
+                    s->boeg_pos, s->boeg_pos, mask, mask_capture);
+            value = mask_capture == 0 ? 0.0 :
+                    _EM_chance(s, s->boeg_pos, mask_capture, true, depth,
+                               hash_capture);
+            // Like the heuristic strategies, always capture if possible
+            *best_pos = s->boeg_pos;
+            return value;
+        }
+        // Positions exactly dice_roll steps away
+        reachable = ReachTable_get(&binfo->reach_player, pos, dice_roll, &nReachable);
+        for (i = 0; i < nReachable; ++i) {
+            u = reachable[i];
+            // Landing on the Boeg is covered by capture above
+            if (u == s->boeg_pos)
+                continue;
+            // No lookahead while chasing the Boeg (hash is not needed)
+            value = _EM_value(s, u, mask, false, depth, 0);
+            if (value < best) {
+                best = value;
+                *best_pos = u;
+            }
+        }
+    }
+    // No valid moves -> skip turn
+    if (best == INFINITY) {
+        best = _EM_value(s, pos, mask, isBoeg, depth, hash);
+    }
+    return best;
+}
+
+// Expected turns left before rolling the dice at pos (hash of state)
+static double _EM_chance(_EMSearch *s, unsigned int pos, unsigned int mask,
+                         bool isBoeg, unsigned int depth, uint64_t hash)
+{
+    // State (incl. owner of Boeg & visited targets) is covered by hash
+    const uint64_t key = hash ^ _EM_mix(s->salt + depth);
+    uint64_t data;
+    double value;
+    if (TTable_probe(s->table, key, &data)) {
+        memcpy(&value, &data, sizeof(value));
+        return value;
+    }
+
+    if (s->aborted || _EM_out_of_budget(s)) {
+        s->aborted = true;
+        return 0.0;  // result is discarded
+    }
+    ++s->nodes;
+
+    unsigned int dummy;
+    double sum = 0.0;
+    for (int d = 1; d <= DIE_SIZE; ++d) {
+        sum += _EM_decision(s, pos, mask, isBoeg, d, depth, hash, &dummy);
+    }
+    value = sum / DIE_SIZE;
+    // Only store fully evaluated nodes
+    if (!s->aborted) {
+        memcpy(&data, &value, sizeof(data));
+        TTable_store(s->table, key, data);
+    }
+    return value;
+}
+
+static void *_Expectimax_board_init(const BoardInfo_t *binfo)
+{
+    (void) binfo;
+    _EMBoard *board = (_EMBoard *) malloc(sizeof(_EMBoard));
+    assert(board != NULL);
+    board->endgame_leaf = false;
+    return board;
+}
+
+static void _Expectimax_board_free(void *ctx)
+{
+    free(ctx);
+}
+
+// Let EXPECTIMAX estimate leaves on board by the endgame table of the Boeg
+// instead of the nearest-neighbor tour; loads the endgame tables and
+// returns false if they could not be loaded (see endgame_gen). Must be
+// called before the first move using EXPECTIMAX
+bool Expectimax_use_endgame(BoardInfo_t *binfo)
+{
+    if (!Endgame_load(binfo))
+        return false;
+    ((_EMBoard *) binfo->strategy_board[EXPECTIMAX])->endgame_leaf = true;
+    return true;
+}
+
+// Whether EXPECTIMAX estimates leaves on board by the endgame table
+bool Expectimax_endgame_leaf(const BoardInfo_t *binfo)
+{
+    BoardInfo_wait(binfo);  // contexts are built in the background
+    return ((const _EMBoard *) binfo->strategy_board[EXPECTIMAX])->endgame_leaf;
+}
+
+static void *_Expectimax_thread_init(const BoardInfo_t *binfo,
+                                     const void *board_ctx)
+{
+    (void) binfo;
+    (void) board_ctx;
+    _EMContext *ctx = (_EMContext *) malloc(sizeof(_EMContext));
+    assert(ctx != NULL);
+    TTable_init(&ctx->table, EXPECTIMAX_TT_BITS);
+    ctx->generation = 0;
+    return ctx;
+}
+
+static void _Expectimax_thread_free(void *thread_ctx)
+{
+    _EMContext *ctx = (_EMContext *) thread_ctx;
+    TTable_free(&ctx->table);
+    free(ctx);
+}
+
+static inline uint64_t _EM_double_bits(double x)
+{
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return bits;
+}
+
+// EXPECTIMAX STRATEGY:
+// Move to destination minimizing expected number of turns left
+enum STATUS GameState_move_expectimax(const BoardInfo_t *binfo,
+            const StrategyCtx_t *ctx, GameState_t *gstate,
+            unsigned int player_id, const AvoidParams_t *params, bool verbose) {
+    const _EMBoard *board = (const _EMBoard *) ctx->board;
+    _EMContext *em = (_EMContext *) ctx->thread;
+    unsigned int i;
+    // Roll dice
+    int dice_roll = roll_dice(gstate);
+    if (verbose)
+        printf("\n%sDice Roll: %d%s\n\n", PLAYER_COLORS[player_id],
+            dice_roll, DEFAULT_COLOR);
+
+    // Gather static information of search
+    _EMSearch s;
+    s.binfo = binfo;
+    s.nOpp = 0;
+    s.boeg_pos = gstate->boeg_pos;
+    s.boeg_id = gstate->boeg_id;
+    s.player_id = player_id;
+    s.params = *params;
+    s.table = &em->table;
+    s.endgame = board->endgame_leaf ? Endgame_boeg_table(binfo) : NULL;
+    assert(!board->endgame_leaf || s.endgame != NULL);
+    s.home_pos = gstate->player_pos[player_id];
+    s.nodes = 0;
+    s.aborted = false;
+    clock_gettime(CLOCK_MONOTONIC, &s.start);
+
+    unsigned int mask = 0;
+    const unsigned int offset_targets = player_id * N_TARGETS_PLAYER;
+    for (i = 0; i < N_TARGETS_PLAYER; ++i) {
+        s.targets[i] = gstate->player_targets[offset_targets + i];
+        if (s.targets[i] != N_TARGETS)
+            mask |= 1u << i;
+    }
+    for (i = 0; i < gstate->nPlayers; ++i) {
+        if (i == player_id || !is_active_player(gstate, i))
+            continue;
+        s.opp_pos[s.nOpp++] = gstate->player_pos[i];
+    }
+    // Together with the hash of the state, keys cover every input of the
+    // values (player, objective, leaf estimate); the generation keeps
+    // searches apart altogether, such that hits (and thus the node budget)
+    // only depend on the search itself
+    s.salt = _EM_mix((uint64_t)player_id + 1) ^
+             _EM_mix(_EM_double_bits(params->base_avoidance)) ^
+             _EM_mix(_EM_double_bits(params->far_factor) + 1) ^
+             _EM_mix((++em->generation << 1) | (s.endgame != NULL));
+
+    const bool isBoeg = player_id == gstate->boeg_id;
+    const unsigned int pos = isBoeg ? gstate->boeg_pos : gstate->player_pos[player_id];
+    // Iterative deepening
+    unsigned int best_pos = pos, candidate;
+    unsigned int depth, completed = 0;
+    double best = 0.0, value;
+    for (depth = 1; depth <= EXPECTIMAX_MAX_DEPTH; ++depth) {
+        value = _EM_decision(&s, pos, mask, isBoeg, dice_roll, depth,
+                             gstate->hash, &candidate);
+        // Shallowest search is always played (only expands chance nodes
+        // after capturing the Boeg)
+        if (s.aborted && depth > 1)
+            break;
+        best = value;
+        best_pos = candidate;
+        completed = depth;
+    }
+
+    if (verbose) {
+        printf("Depth: %u, Nodes: %lu, Expected turns left: %.2f\n",
+               completed, s.nodes, best);
+        if (best_pos == pos)
+            printf("Skipping turn...\n");
+        else
+            printf("%sPlayer %u%s moves to '%s'\n", PLAYER_COLORS[player_id],
+                   player_id+1, DEFAULT_COLOR, binfo->locations[best_pos].name);
+    }
+    return GameState_apply_move(binfo, gstate, player_id, best_pos, dice_roll);
+}
+
+static const Strategy_t STRATEGY_EXPECTIMAX = {
+    .name = "EXPECTIMAX",
+    .init = _Expectimax_board_init,
+    .free = _Expectimax_board_free,
+    .thread_init = _Expectimax_thread_init,
+    .thread_free = _Expectimax_thread_free,
+    .move = GameState_move_expectimax
+};
+
+#endif /* EXPECTIMAX_H */
@@ -9,6 +9,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>  // memcpy
 #include <math.h>
 #include <assert.h>
 
@@ -16,19 +17,31 @@
 #include FT_FREETYPE_H
 
 #include "gl_common.h"
+#include "trace.h"
 
 #if !defined(ORIGIN_WIDTH) || !defined(ORIGIN_HEIGHT)
 #error "Need to set screen resolution ORIGIN_WIDTH and ORIGIN_HEIGHT."
 #endif
 
 #define N_CHARS 128
+// Glyph atlas (single texture, glyphs packed row by row)
+#define FONT_ATLAS_WIDTH 1024
+#define FONT_ATLAS_MAX_HEIGHT 1024
+#define FONT_ATLAS_PADDING 1
+// Vertex of batched text: <vec2 pos, vec2 tex, vec3 textColor, vec3 bgColor>
+#define FONT_VERTEX_FLOATS 10
+#define FONT_BATCH_GLYPHS 256  // initial capacity of batch
 
 // Shaders
 static const GLchar *_fontVertShaderSource = R"glsl(
 #version 460 core
 layout(location = 0) in vec4 aVert;  // <vec2 pos, vec2 tex>
+layout(location = 1) in vec3 aTextColor;
+layout(location = 2) in vec3 aBackgroundColor;
 
 out vec2 texCoords;
+out vec3 textColor;
+out vec3 backgroundColor;
 
 uniform mat4 projection;
 
@@ -36,18 +49,20 @@ void main()
 {
     gl_Position = projection * vec4(aVert.xy, 0.0, 1.0);
     texCoords = aVert.zw;
+    textColor = aTextColor;
+    backgroundColor = aBackgroundColor;
 }
 )glsl";
 
 static const GLchar *_fontFragShaderSource = R"glsl(
 #version 460 core
 in vec2 texCoords;
+in vec3 textColor;
+in vec3 backgroundColor;
 
 out vec4 fragColor;
 
 uniform sampler2D text;
-uniform vec3 textColor;
-uniform vec3 backgroundColor;
 
 void main()
 {
@@ -62,7 +77,7 @@ typedef struct {
 } TextDims;
 
 typedef struct {
-    GLuint textureId;
+    GLfloat u0, v0, u1, v1;  // rectangle of glyph in atlas
     GLuint width;
     GLuint rows;
     GLuint bearingX;
@@ -73,8 +88,15 @@ typedef struct {
 // Globals
 static _FontChar _fontChars[N_CHARS];
 static GLuint _fontShaderProgram;
+static GLUniformMat4 _fontProjection;
+static GLuint _fontAtlas;
 static GLuint _fontVao, _fontVbo;
+// Quads of text queued since last fontFlush (FONT_VERTEX_FLOATS per vertex)
+static GLfloat *_fontBatch = NULL;
+static GLuint _fontBatchGlyphs = 0, _fontBatchCapacity = 0;
+static GLuint _fontVboCapacity = 0;  // in glyphs
 
+// Render first N_CHARS characters of font into glyph atlas (_fontAtlas)
 void fontToTexture(const char *fontPath)
 {
     FT_Library ft;
@@ -99,7 +121,12 @@ void fontToTexture(const char *fontPath)
         exit(EXIT_FAILURE);
     }
     
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    unsigned char *atlas = (unsigned char *) calloc(
+            FONT_ATLAS_WIDTH*FONT_ATLAS_MAX_HEIGHT, sizeof(unsigned char));
+    assert(atlas != NULL);
+    GLuint atlasX[N_CHARS], atlasY[N_CHARS];
+    // Shelf packing: glyphs left to right, next row below tallest glyph
+    GLuint x = FONT_ATLAS_PADDING, y = FONT_ATLAS_PADDING, rowHeight = 0;
     // Iterate over first N_CHARS ascii characters
     for (unsigned char c = 0; c < N_CHARS; ++c) {
         // Render glyph in glyph slot
@@ -108,71 +135,116 @@ void fontToTexture(const char *fontPath)
             fprintf(stderr, "Failed to load char: %u\n", c);
             exit(EXIT_FAILURE);
         }
-        // Create texture from glyph slot
-        GLuint texture;
-        glGenTextures(1, &texture);
-        glBindTexture(GL_TEXTURE_2D, texture);
-        glTexImage2D(GL_TEXTURE_2D,
-                     0,
-                     GL_RED,
-                     face->glyph->bitmap.width,
-                     face->glyph->bitmap.rows,
-                     0,
-                     GL_RED,
-                     GL_UNSIGNED_BYTE,
-                     face->glyph->bitmap.buffer);
-        // Set texture options
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        // Store texture information in global variable
+        const FT_Bitmap *bitmap = &face->glyph->bitmap;
+        if (x + bitmap->width + FONT_ATLAS_PADDING > FONT_ATLAS_WIDTH) {
+            x = FONT_ATLAS_PADDING;
+            y += rowHeight + FONT_ATLAS_PADDING;
+            rowHeight = 0;
+        }
+        if (y + bitmap->rows + FONT_ATLAS_PADDING > FONT_ATLAS_MAX_HEIGHT) {
+            fprintf(stderr, "Glyph atlas too small for font\n");
+            exit(EXIT_FAILURE);
+        }
+        // Copy glyph into atlas (rows of bitmap may be padded)
+        for (GLuint r = 0; r < bitmap->rows; ++r) {
+            memcpy(&atlas[(y + r)*FONT_ATLAS_WIDTH + x],
+                   &bitmap->buffer[r*bitmap->pitch], bitmap->width);
+        }
+        atlasX[c] = x;
+        atlasY[c] = y;
+        // Store glyph information in global variable (texture coordinates
+        // follow once height of atlas is known)
         _fontChars[(GLuint)c] = (_FontChar) {
-            texture,
-            face->glyph->bitmap.width, face->glyph->bitmap.rows,
+            0.0f, 0.0f, 0.0f, 0.0f,
+            bitmap->width, bitmap->rows,
             face->glyph->bitmap_left, face->glyph->bitmap_top,
             face->glyph->advance.x
         };
+        x += bitmap->width + FONT_ATLAS_PADDING;
+        if (bitmap->rows > rowHeight)
+            rowHeight = bitmap->rows;
+    }
+    const GLuint height = y + rowHeight + FONT_ATLAS_PADDING;
+    for (GLuint c = 0; c < N_CHARS; ++c) {
+        _FontChar *fc = &_fontChars[c];
+        fc->u0 = (GLfloat)atlasX[c] / FONT_ATLAS_WIDTH;
+        fc->v0 = (GLfloat)atlasY[c] / height;
+        fc->u1 = (GLfloat)(atlasX[c] + fc->width) / FONT_ATLAS_WIDTH;
+        fc->v1 = (GLfloat)(atlasY[c] + fc->rows) / height;
     }
-    glBindTexture(GL_TEXTURE_2D, 0);
+    
+    // Upload used rows of atlas
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glGenTextures(1, &_fontAtlas);
+    bindTexture2DCached(_fontAtlas);
+    glTexImage2D(GL_TEXTURE_2D,
+                 0,
+                 GL_RED,
+                 FONT_ATLAS_WIDTH,
+                 height,
+                 0,
+                 GL_RED,
+                 GL_UNSIGNED_BYTE,
+                 atlas);
+    // Set texture options
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     // Clean-up
+    free(atlas);
     FT_Done_Face(face);
     FT_Done_FreeType(ft);
 }
 
 void fontInit(const char *fontPath)
 {
+    const uint64_t span = Trace_begin();
     // Initialize shader programs
     _fontShaderProgram = createGLProgram(_fontVertShaderSource, _fontFragShaderSource);
-    glUseProgram(_fontShaderProgram);
+    // Resolve uniforms once
+    _fontProjection = getUniformMat4(_fontShaderProgram, "projection");
+    useProgramCached(_fontShaderProgram);
     // Orthographic projection matrix for text
     mat4 proj;
     glm_ortho(0.0f, ORIGIN_WIDTH, 0.0f, ORIGIN_HEIGHT, -1.0f, 1.0f, proj);
     // Set projection matrix
-    GLint projLoc  = glGetUniformLocation(_fontShaderProgram, "projection");
-	glUniformMatrix4fv(projLoc, 1, GL_FALSE, (GLfloat *)proj);
+    setUniformMat4(_fontProjection, (GLfloat *)proj);
+    // Glyphs are sampled from texture unit 0 (default, never changed)
+    glActiveTexture(GL_TEXTURE0);
     
-    // Create textures for given font
+    // Create glyph atlas for given font
     fontToTexture(fontPath);
     
+    // Batch of quads (6 vertices per glyph), refilled every frame
+    _fontBatchCapacity = FONT_BATCH_GLYPHS;
+    _fontBatch = (GLfloat *) malloc(_fontBatchCapacity*6*FONT_VERTEX_FLOATS*
+                                    sizeof(GLfloat));
+    assert(_fontBatch != NULL);
+    _fontBatchGlyphs = 0;
+    
     // Create vertex buffer arrays
-    // - 2D quad with 6 vertices @ 4 components
-    // - Dynamic drawing to allow updating content of vbo
+    // - Stream drawing: content of vbo is replaced every frame
     glGenVertexArrays(1, &_fontVao);
     glGenBuffers(1, &_fontVbo);
-    glBindVertexArray(_fontVao);
-    glBindBuffer(GL_ARRAY_BUFFER, _fontVbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat)*6*4, NULL, GL_DYNAMIC_DRAW);
-    glVertexAttribPointer(0,
-                          4,
-                          GL_FLOAT,
-                          GL_FALSE,
-                          4*sizeof(GLfloat),
-                          NULL);
+    bindVertexArrayCached(_fontVao);
+    bindArrayBufferCached(_fontVbo);
+    _fontVboCapacity = _fontBatchCapacity;
+    glBufferData(GL_ARRAY_BUFFER, _fontVboCapacity*6*FONT_VERTEX_FLOATS*
+                 sizeof(GLfloat), NULL, GL_STREAM_DRAW);
+    const GLsizei stride = FONT_VERTEX_FLOATS*sizeof(GLfloat);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride, NULL);
     glEnableVertexAttribArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);  // unbind
-    glUseProgram(0);    
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride,
+                          (void *)(4*sizeof(GLfloat)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride,
+                          (void *)(7*sizeof(GLfloat)));
+    glEnableVertexAttribArray(2);
+    bindArrayBufferCached(0);
+    bindVertexArrayCached(0);  // unbind
+    useProgramCached(0);
+    Trace_end("fontInit", span);
 }
 
 // Assumes text is null-terminated
@@ -187,8 +259,7 @@ TextDims fontGetTextDims(const char *text, GLfloat scale)
     GLfloat yMax = -INFINITY;
     
     GLfloat cursor = 0.0f;
-    const char *iter = text;
-    while (*iter) {
+    for (const char *iter = text; *iter; ++iter) {
         GLuint index = (GLuint)*iter;
         if (index >= N_CHARS) {
             fprintf(stderr, "Unrecognized char: %u.\n", index);
@@ -211,8 +282,6 @@ TextDims fontGetTextDims(const char *text, GLfloat scale)
         if (yPos + h > yMax) yMax = yPos + h;
         // Update cursor position
         cursor += (fc.advance >> 6)*scale;
-        // Increment iterator
-        ++iter;
     }
     GLfloat width = xMax - xMin; assert(width > 0.0f);
     GLfloat height = yMax - yMin; assert(height > 0.0f);
@@ -220,7 +289,17 @@ TextDims fontGetTextDims(const char *text, GLfloat scale)
     return (TextDims) {.width = width, .height = height};
 }
 
-// Assumes text is null-terminated
+// Append vertex to batch
+static inline GLfloat *_fontPutVertex(GLfloat *v, GLfloat x, GLfloat y,
+        GLfloat u, GLfloat t, const vec3 textCol, const vec3 bgCol)
+{
+    v[0] = x; v[1] = y; v[2] = u; v[3] = t;
+    v[4] = textCol[0]; v[5] = textCol[1]; v[6] = textCol[2];
+    v[7] = bgCol[0]; v[8] = bgCol[1]; v[9] = bgCol[2];
+    return v + FONT_VERTEX_FLOATS;
+}
+
+// Queue text for next fontFlush (assumes text is null-terminated)
 void fontRenderText(const char *text, GLfloat x, GLfloat y, 
                 GLfloat scale, const vec3 textCol, const vec3 bgCol)
 {
@@ -230,20 +309,7 @@ void fontRenderText(const char *text, GLfloat x, GLfloat y,
            (0.0f <= y && y <= ORIGIN_HEIGHT));
     assert(text);
     
-    // Use shader program
-    glUseProgram(_fontShaderProgram);
-    // Set text color
-    GLint textColLoc = glGetUniformLocation(_fontShaderProgram, "textColor");
-    glUniform3f(textColLoc, textCol[0], textCol[1], textCol[2]);
-    // Set background color
-    GLint bgColLoc = glGetUniformLocation(_fontShaderProgram, "backgroundColor");
-    glUniform3f(bgColLoc, bgCol[0], bgCol[1], bgCol[2]);
-    
-    glActiveTexture(GL_TEXTURE0);  // activate texture unit
-    glBindVertexArray(_fontVao);
-    
-    const char *iter = text;
-    while (*iter) {
+    for (const char *iter = text; *iter; ++iter) {
         GLuint index = (GLuint)*iter;
         if (index >= N_CHARS) {
             fprintf(stderr, "Unrecognized char: %u.\n", index);
@@ -258,33 +324,50 @@ void fontRenderText(const char *text, GLfloat x, GLfloat y,
         
         GLfloat w    = fc.width*scale;
         GLfloat h    = fc.rows*scale;
-        // Quad vertices, including texture coordinates
-        const GLfloat vertices[6][4] = {
-            {xPos    , yPos + h, 0.0f, 0.0f},
-            {xPos    , yPos    , 0.0f, 1.0f},
-            {xPos + w, yPos    , 1.0f, 1.0f},
-            
-            {xPos    , yPos + h, 0.0f, 0.0f},
-            {xPos + w, yPos    , 1.0f, 1.0f},
-            {xPos + w, yPos + h, 1.0f, 0.0f}
-        };
-        // Render glyph texture over quad
-        glBindTexture(GL_TEXTURE_2D, fc.textureId);
-        glBindBuffer(GL_ARRAY_BUFFER, _fontVbo);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);  // unbind
-        // Render Quad
-        glDrawArrays(GL_TRIANGLES, 0, 6);
         // Update cursor position by advance (divide by 64 since it is
         // the number of 1/64 pixels)
         x += (fc.advance >> 6)*scale;
-        // Increment iterator
-        ++iter;
+        if (fc.width == 0 || fc.rows == 0)
+            continue;  // nothing to draw (e.g. space)
+        
+        if (_fontBatchGlyphs == _fontBatchCapacity) {
+            _fontBatchCapacity *= 2;
+            _fontBatch = (GLfloat *) realloc(_fontBatch, _fontBatchCapacity*6*
+                    FONT_VERTEX_FLOATS*sizeof(GLfloat));
+            assert(_fontBatch != NULL);
+        }
+        // Quad vertices, including texture coordinates in atlas
+        GLfloat *v = &_fontBatch[_fontBatchGlyphs++*6*FONT_VERTEX_FLOATS];
+        v = _fontPutVertex(v, xPos    , yPos + h, fc.u0, fc.v0, textCol, bgCol);
+        v = _fontPutVertex(v, xPos    , yPos    , fc.u0, fc.v1, textCol, bgCol);
+        v = _fontPutVertex(v, xPos + w, yPos    , fc.u1, fc.v1, textCol, bgCol);
+        
+        v = _fontPutVertex(v, xPos    , yPos + h, fc.u0, fc.v0, textCol, bgCol);
+        v = _fontPutVertex(v, xPos + w, yPos    , fc.u1, fc.v1, textCol, bgCol);
+        v = _fontPutVertex(v, xPos + w, yPos + h, fc.u1, fc.v0, textCol, bgCol);
+    }
+}
+
+// Draw all queued text with one upload and one draw call. Text queued
+// first is on top where strings overlap (depth test)
+void fontFlush()
+{
+    if (_fontBatchGlyphs == 0)
+        return;
+    useProgramCached(_fontShaderProgram);
+    bindVertexArrayCached(_fontVao);
+    bindArrayBufferCached(_fontVbo);
+    bindTexture2DCached(_fontAtlas);
+    const GLsizeiptr size = _fontBatchGlyphs*6*FONT_VERTEX_FLOATS*sizeof(GLfloat);
+    if (_fontBatchGlyphs > _fontVboCapacity) {
+        // Grow buffer (uploads batch as well)
+        _fontVboCapacity = _fontBatchCapacity;
+        glBufferData(GL_ARRAY_BUFFER, _fontVboCapacity*6*FONT_VERTEX_FLOATS*
+                     sizeof(GLfloat), NULL, GL_STREAM_DRAW);
     }
-    // Unbind vao, texture and shader program again
-    glBindVertexArray(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glUseProgram(0);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, size, _fontBatch);
+    glDrawArrays(GL_TRIANGLES, 0, 6*_fontBatchGlyphs);
+    _fontBatchGlyphs = 0;
 }
 
 void fontRenderTextCentered(const char *text, GLfloat cx, GLfloat cy, 
@@ -5,7 +5,9 @@
  * runs of the game.
  * 
  * Depends on:
+ * - Strategy interface (vtable with per-board & per-thread context)
  * - Graph data structure (adjacency list) + algorithms
+ * - Reachability table (precomputed reachable positions per dice roll)
  * - Location data structure (name + vertex number)
  */
 
@@ -20,18 +22,38 @@
 #include <stdint.h>
 #include <assert.h>
 #include <math.h>  // INFINITY
+#include <stdatomic.h>
 
 #include "graph.h"
+#include "reach_table.h"
+#include "zobrist.h"
 #include "location.h"
 #include "splitmix64.h"
+#include "thread_pool.h"
+#include "perf_counters.h"
+#include "trace.h"
 
 #define DIE_SIZE (6)
 #define MAX_TURNS (100)
 #define MIN_PLAYERS (3)
 #define MAX_PLAYERS (6)
 #define BOEG_ID_DEFAULT (MAX_PLAYERS + 1)
+// Positions 0, ..., N_TARGETS-1 of a board are targets (boards generated
+// with a different number of targets need -DN_TARGETS=...)
+#ifndef N_TARGETS
 #define N_TARGETS (40)
+#endif
 #define N_TARGETS_PLAYER (4)
+#if N_TARGETS <= MAX_PLAYERS * N_TARGETS_PLAYER
+#error "N_TARGETS must exceed the targets of all players (Boeg starts on a target)."
+#endif
+// Directory of board files read by BoardInfo_init
+#ifndef BOARD_DIR
+#define BOARD_DIR "board"
+#endif
+// Default parameters of avoidance objective
+#define BASE_AVOIDANCE_DEFAULT (40.0)
+#define FAR_FACTOR_DEFAULT (2.0)
 
 // Colors used for terminal output
 static const char *DEFAULT_COLOR = "\033[0m";
@@ -56,14 +78,45 @@ enum STATUS {
 enum MOVE_STRATEGY {
     GREEDY,
     AVOIDANT,
+    EXPECTIMAX,
+    MCTS,
+    ENDGAME,
     USER_COMMAND
 };
 
 static const char *STRATEGY_NAMES[] = {
     "GREEDY",
     "AVOIDANT",
+    "EXPECTIMAX",
+    "MCTS",
+    "ENDGAME",
     "USER COMMAND"
 };
+#define N_STRATEGIES (USER_COMMAND + 1)
+
+// Latency histograms of moves (need N_STRATEGIES)
+#include "move_timing.h"
+
+// Parameters of objective used to avoid opponents as Boeg
+typedef struct {
+    double base_avoidance;  // weight of opponent proximity (all targets left)
+    double far_factor;      // penalty divisor if opponent cannot reach
+                            // position within one dice roll
+} AvoidParams_t;
+
+static const AvoidParams_t AVOID_PARAMS_DEFAULT = {
+    .base_avoidance = BASE_AVOIDANCE_DEFAULT,
+    .far_factor = FAR_FACTOR_DEFAULT
+};
+
+// Background part of board initialization (see BoardInfo_init_lazy)
+typedef struct {
+    pthread_t player, boeg;  // threads computing tables
+    bool async_player, async_boeg;
+    pthread_mutex_t mutex;
+    atomic_bool ready;       // all tables are published
+    bool joined;             // boeg (and thereby player) were joined
+} BoardInit_t;
 
 // Encodes all static information about game board
 typedef struct {
@@ -75,8 +128,16 @@ typedef struct {
     // Arrays containing shortest path data
     int *dist_player, *dist_boeg;
     int *par_player, *par_boeg;
+    // Positions reachable in exactly 1..DIE_SIZE steps
+    ReachTable reach_player, reach_boeg;
+    // Read-only context of strategies built for this board (see strategy.h)
+    void *strategy_board[N_STRATEGIES];
     // Number of positions on board
     unsigned int nPositions;
+    // Directory board was read from (e.g. endgame tables are stored there)
+    char *board_dir;
+    // Tables still being computed (see BoardInfo_wait)
+    BoardInit_t *init;
 } BoardInfo_t;
 
 // Encodes all information of current state of the game
@@ -90,17 +151,36 @@ typedef struct {
     unsigned int boeg_id;  // Keeps track which player is currently the boeg
     // Number of players
     unsigned int nPlayers;
+    // Zobrist hash of all of the above (except static targets)
+    uint64_t hash;
+    // Dice are drawn from their own stream (seeded on init/reset), such
+    // that random numbers consumed by strategies do not shift the dice
+    uint64_t dice_state;
+    bool antithetic;  // roll DIE_SIZE + 1 - d instead of d
     // Auxiliary buffers needed for graph algorithms
     bool *visited_buf;
     int *distances_buf;
+    unsigned int *moves_buf;  // legal moves (see GameState_legal_moves)
+    // Scratch context of strategies used by owning thread (see strategy.h)
+    void *strategy_thread[N_STRATEGIES];
+    // Histograms of owning thread (NULL: moves are not timed)
+    MoveTiming_t *timing;
+    enum MOVE_PATH move_path;  // code path taken by last move
 } GameState_t;
 
 // Encodes information about results of game
 typedef struct {
     int winner;
-    unsigned int nTurns;
+    unsigned int nTurns;                 // number of rounds played
+    unsigned int winTurn;                // round in which winner finished
+    unsigned int ranking[MAX_PLAYERS];   // players in order of finishing
+    unsigned int nRanked;
+    unsigned int captures[MAX_PLAYERS];  // how often player captured Boeg
+    unsigned int nMoves;                 // moves made (incl. Boeg captures)
 } GameResult_t;
 
+#include "strategy.h"
+
 // Print string in a given color to console
 void print_colored(const char *text, const char *color) {
     printf("%s%s%s", color, text, DEFAULT_COLOR);
@@ -124,9 +204,10 @@ void shuffle(unsigned int *array, size_t n) {
     }
 }
 
-// Roll single dice and return result
-int roll_dice() {
-    return (int)(next() % DIE_SIZE) + 1;
+// Roll single dice from stream of game and return result
+int roll_dice(GameState_t *gstate) {
+    const int roll = (int)(next_r(&gstate->dice_state) % DIE_SIZE) + 1;
+    return gstate->antithetic ? DIE_SIZE + 1 - roll : roll;
 }
 
 // Determine if there is an opponent at the specified target location
@@ -142,6 +223,52 @@ bool opponent_at_target(const GameState_t *gstate, unsigned int target,
     return false;
 }
 
+// Compute Zobrist hash of game state from scratch
+uint64_t GameState_hash(const GameState_t *gstate) {
+    uint64_t hash = Zobrist_key(ZOBRIST_BOEG_POS, 0, gstate->boeg_pos) ^
+                    Zobrist_key(ZOBRIST_BOEG_ID, 0, gstate->boeg_id);
+    unsigned int i, target;
+    for (i = 0; i < gstate->nPlayers; ++i) {
+        hash ^= Zobrist_key(ZOBRIST_PLAYER_POS, i, gstate->player_pos[i]);
+        hash ^= Zobrist_key(ZOBRIST_ORDER, i, gstate->player_order[i]);
+    }
+    for (i = 0; i < gstate->nPlayers * N_TARGETS_PLAYER; ++i) {
+        target = gstate->player_targets[i];
+        if (target != N_TARGETS)
+            hash ^= Zobrist_key(ZOBRIST_TARGET, i, target);
+    }
+    return hash;
+}
+
+// Setters of game state that keep the hash up to date (O(1))
+void GameState_set_player_pos(GameState_t *gstate, unsigned int player_id,
+                              unsigned int pos) {
+    gstate->hash ^= Zobrist_key(ZOBRIST_PLAYER_POS, player_id, 
+                                gstate->player_pos[player_id]) ^
+                    Zobrist_key(ZOBRIST_PLAYER_POS, player_id, pos);
+    gstate->player_pos[player_id] = pos;
+}
+
+void GameState_set_boeg_pos(GameState_t *gstate, unsigned int pos) {
+    gstate->hash ^= Zobrist_key(ZOBRIST_BOEG_POS, 0, gstate->boeg_pos) ^
+                    Zobrist_key(ZOBRIST_BOEG_POS, 0, pos);
+    gstate->boeg_pos = pos;
+}
+
+void GameState_set_boeg_id(GameState_t *gstate, unsigned int boeg_id) {
+    gstate->hash ^= Zobrist_key(ZOBRIST_BOEG_ID, 0, gstate->boeg_id) ^
+                    Zobrist_key(ZOBRIST_BOEG_ID, 0, boeg_id);
+    gstate->boeg_id = boeg_id;
+}
+
+// Mark target slot (player_id * N_TARGETS_PLAYER + slot) as visited
+void GameState_clear_target(GameState_t *gstate, unsigned int target_index) {
+    assert(gstate->player_targets[target_index] != N_TARGETS);
+    gstate->hash ^= Zobrist_key(ZOBRIST_TARGET, target_index, 
+                                gstate->player_targets[target_index]);
+    gstate->player_targets[target_index] = N_TARGETS;
+}
+
 // Check if given location is active target location of player, in which
 // case it is marked as visited (invalidated)
 bool is_active_target(GameState_t *gstate, unsigned int location,
@@ -155,7 +282,7 @@ bool is_active_target(GameState_t *gstate, unsigned int location,
         target = gstate->player_targets[target_index];
         // Check if location is an active target of player
         if (target != N_TARGETS && location == target) {
-            gstate->player_targets[target_index] = N_TARGETS;
+            GameState_clear_target(gstate, target_index);
             return true;
         }
     }
@@ -190,7 +317,7 @@ unsigned int print_path(const int *parents, const Location_t *locations,
                     int source, int target, int n, unsigned int dist,
                     const char *color) {
     assert((0 <= source && source < n) && (0 <= target && target < n));
-    unsigned int final_pos;
+    unsigned int final_pos = target;  // if at most dist steps away
     __print_path(parents, locations, target, source * n, dist,
                     &final_pos, color);
     return final_pos;   
@@ -216,38 +343,117 @@ unsigned int __follow_path(const int *parents, int target, int offset,
 unsigned int follow_path(const int *parents, int source, int target,
                             int n, unsigned int dist) {
     assert((0 <= source && source < n) && (0 <= target && target < n));
-    unsigned int final_pos;
+    unsigned int final_pos = target;  // if at most dist steps away
     __follow_path(parents, target, source * n, dist, &final_pos);
     return final_pos;   
 }
 
-void BoardInfo_init(BoardInfo_t *binfo) 
+// Shortest paths & reachable positions of players (see BoardInfo_init_lazy)
+static void *_BoardInfo_player_tables(void *arg)
+{
+    BoardInfo_t *binfo = (BoardInfo_t *) arg;
+    Perf_begin(PERF_APSP);
+    uint64_t span = Trace_begin();
+    Graph_BFS_APSP(&binfo->graph, false, binfo->dist_player, binfo->par_player);
+    Trace_end("APSP player", span);
+    Perf_end(PERF_APSP);
+    span = Trace_begin();
+    ReachTable_init(&binfo->reach_player, &binfo->graph, false, DIE_SIZE);
+    Trace_end("reach table player", span);
+    return NULL;
+}
+
+// Tables of Boeg, then contexts of strategies (need tables of players);
+// publishes all tables
+static void *_BoardInfo_boeg_tables(void *arg)
 {
-    assert(binfo);
+    BoardInfo_t *binfo = (BoardInfo_t *) arg;
+    BoardInit_t *init = binfo->init;
+    Perf_begin(PERF_APSP);
+    uint64_t span = Trace_begin();
+    Graph_BFS_APSP(&binfo->graph, true, binfo->dist_boeg, binfo->par_boeg);
+    Trace_end("APSP Boeg", span);
+    Perf_end(PERF_APSP);
+    span = Trace_begin();
+    ReachTable_init(&binfo->reach_boeg, &binfo->graph, true, DIE_SIZE);
+    Trace_end("reach table Boeg", span);
+    if (init->async_player)
+        pthread_join(init->player, NULL);
+    // Precompute per-board context of strategies
+    span = Trace_begin();
+    Strategy_board_init(binfo);
+    Trace_end("strategy tables", span);
+    atomic_store_explicit(&init->ready, true, memory_order_release);
+    return NULL;
+}
+
+// Initialize board from graph.txt & locations.txt in board_dir (number of
+// targets must match N_TARGETS, if given by targets.txt). Returns
+// once graph & locations are read; shortest paths, reachable positions and
+// contexts of strategies are computed in the background (tables of players
+// and of the Boeg concurrently, while locations are read) and may only be
+// used after BoardInfo_wait
+void BoardInfo_init_lazy(BoardInfo_t *binfo, const char *board_dir)
+{
+    assert(binfo && board_dir);
+    Perf_begin(PERF_BOARD_INIT);
+    const uint64_t span_init = Trace_begin();
+    uint64_t span;
+    char path[4096];
     // Initialize graphs (adjacency lists)
     FILE *fp = NULL;
-    fp = fopen("board/graph.txt", "r");
+    snprintf(path, sizeof(path), "%s/graph.txt", board_dir);
+    fp = fopen(path, "r");
     
     if (fp == NULL) {
-        fprintf(stderr, "Could not open board graph\n");
+        fprintf(stderr, "Could not open board graph '%s'\n", path);
         exit(EXIT_FAILURE);
     }
+    binfo->board_dir = strdup(board_dir);
+    assert(binfo->board_dir != NULL);
     // Init graphs
+    span = Trace_begin();
     Graph_init_file(&binfo->graph, fp);
     fclose(fp);
+    Trace_end("parse graph", span);
     
     // Number of total vertices
     const unsigned int nVert = binfo->graph.nVert;
+    if (nVert <= N_TARGETS) {
+        fprintf(stderr, "Board needs more than %d positions\n", N_TARGETS);
+        exit(EXIT_FAILURE);
+    }
     // Set number of positions
     binfo->nPositions = nVert;
     
+    // Number of targets of board (optional; boards without targets.txt
+    // have N_TARGETS targets)
+    snprintf(path, sizeof(path), "%s/targets.txt", board_dir);
+    fp = fopen(path, "r");
+    if (fp != NULL) {
+        unsigned int nTargets;
+        const bool valid = fscanf(fp, "%u", &nTargets) == 1;
+        fclose(fp);
+        if (!valid) {
+            fprintf(stderr, "Could not read number of targets from '%s'\n", path);
+            exit(EXIT_FAILURE);
+        }
+        if (nTargets != N_TARGETS) {
+            fprintf(stderr, "Board '%s' has %u targets, but engine was built "
+                    "for %d (rebuild with -DN_TARGETS=%u)\n", board_dir,
+                    nTargets, N_TARGETS, nTargets);
+            exit(EXIT_FAILURE);
+        }
+    }
+    
     // Read locations:
     binfo->locations = (Location_t *) malloc(nVert*sizeof(Location_t));
     assert(binfo->locations != NULL);
     binfo->locations_sorted = (Location_t *) malloc(nVert*sizeof(Location_t));
     assert(binfo->locations_sorted != NULL);
     
-    fp = fopen("board/locations.txt", "r");
+    snprintf(path, sizeof(path), "%s/locations.txt", board_dir);
+    fp = fopen(path, "r");
     if (fp == NULL) {
         free(binfo->locations);
         free(binfo->locations_sorted);
@@ -255,14 +461,7 @@ void BoardInfo_init(BoardInfo_t *binfo)
         fprintf(stderr, "Could not open locations file\n");
         exit(EXIT_FAILURE);
     }
-    // Read locations from file into locations array
-    read_locations(fp, binfo->locations, binfo->locations_sorted, binfo->nPositions);
-    // Close locations file
-    fclose(fp);
-    // Sort locations array in ascending order
-    qsort((void *)&binfo->locations_sorted[0], nVert,
-           sizeof(Location_t), &location_cmp);
-                            
+    
     // Initialize distances and parents using BFS APSP
     binfo->dist_player = (int *) malloc(nVert * nVert * sizeof(int));
     assert(binfo->dist_player != NULL);
@@ -274,9 +473,70 @@ void BoardInfo_init(BoardInfo_t *binfo)
     binfo->par_boeg = (int *) malloc(nVert * nVert * sizeof(int));
     assert(binfo->par_boeg != NULL);
     
-    // Compute all pairs shortest paths (APSP) for both boards
-    Graph_BFS_APSP(&binfo->graph, false, binfo->dist_player, binfo->par_player);
-    Graph_BFS_APSP(&binfo->graph, true, binfo->dist_boeg, binfo->par_boeg);
+    // Tables of players & Boeg on their own threads (serially if threads
+    // cannot be created or counters are read, see perf_counters.h)
+    BoardInit_t *init = (BoardInit_t *) malloc(sizeof(BoardInit_t));
+    assert(init != NULL);
+    pthread_mutex_init(&init->mutex, NULL);
+    atomic_init(&init->ready, false);
+    init->joined = false;
+    binfo->init = init;
+    const bool parallel = !Perf_enabled();
+    init->async_player = parallel && pthread_create(&init->player, NULL,
+            _BoardInfo_player_tables, binfo) == 0;
+    if (!init->async_player)
+        _BoardInfo_player_tables(binfo);
+    init->async_boeg = parallel && pthread_create(&init->boeg, NULL,
+            _BoardInfo_boeg_tables, binfo) == 0;
+    if (!init->async_boeg)
+        _BoardInfo_boeg_tables(binfo);
+    
+    // Read locations from file into locations array
+    span = Trace_begin();
+    read_locations(fp, binfo->locations, binfo->locations_sorted, binfo->nPositions);
+    // Close locations file
+    fclose(fp);
+    Trace_end("parse locations", span);
+    // Sort locations array in ascending order
+    span = Trace_begin();
+    qsort((void *)&binfo->locations_sorted[0], nVert,
+           sizeof(Location_t), &location_cmp);
+    Trace_end("qsort locations", span);
+    Perf_end(PERF_BOARD_INIT);
+    Trace_end("BoardInfo_init", span_init);
+}
+
+static void _BoardInfo_join(BoardInit_t *init)
+{
+    pthread_mutex_lock(&init->mutex);
+    if (init->async_boeg && !init->joined)
+        pthread_join(init->boeg, NULL);
+    init->joined = true;
+    pthread_mutex_unlock(&init->mutex);
+}
+
+// Block until all tables of board are computed (see BoardInfo_init_lazy)
+void BoardInfo_wait(const BoardInfo_t *binfo)
+{
+    BoardInit_t *init = binfo->init;
+    if (atomic_load_explicit(&init->ready, memory_order_acquire))
+        return;
+    const uint64_t span = Trace_begin();
+    _BoardInfo_join(init);
+    Trace_end("BoardInfo_wait", span);
+}
+
+// Initialize board from graph.txt & locations.txt in board_dir (all
+// tables ready on return)
+void BoardInfo_init_dir(BoardInfo_t *binfo, const char *board_dir)
+{
+    BoardInfo_init_lazy(binfo, board_dir);
+    BoardInfo_wait(binfo);
+}
+
+void BoardInfo_init(BoardInfo_t *binfo)
+{
+    BoardInfo_init_dir(binfo, BOARD_DIR);
 }
 
 // Initialize game state based on number of players
@@ -296,6 +556,9 @@ void GameState_init(GameState_t *gstate, unsigned int nPlayers,
     
     // Initialize number of players
     gstate->nPlayers = nPlayers;
+    // Initialize dice stream
+    gstate->dice_state = next();
+    gstate->antithetic = false;
     // Initialize Boeg id
     gstate->boeg_id = BOEG_ID_DEFAULT; 
     unsigned int i, j;
@@ -336,23 +599,38 @@ void GameState_init(GameState_t *gstate, unsigned int nPlayers,
     assert(gstate->visited_buf != NULL);
     gstate->distances_buf = (int *) malloc(nPositions * sizeof(int));
     assert(gstate->distances_buf != NULL);
+    gstate->moves_buf = (unsigned int *) 
+            malloc((nPositions + N_TARGETS_PLAYER) * sizeof(unsigned int));
+    assert(gstate->moves_buf != NULL);
+    // Strategy contexts are created on first move
+    memset(gstate->strategy_thread, 0, sizeof(gstate->strategy_thread));
+    gstate->timing = NULL;
+    gstate->move_path = PATH_SEARCH;
+    // Initialize hash
+    gstate->hash = GameState_hash(gstate);
 }
 
 // Reset game state and re-randomize for next round
 void GameState_reset(GameState_t *gstate, unsigned int nPositions) {
     unsigned int i, j;
+    // Re-seed dice stream (antithetic flag is kept)
+    gstate->dice_state = next();
     for (i = 0; i < gstate->nPlayers; ++i) {
         // Place players ONLY on non-target positions to avoid
         // possible collisions with placement of Boeg
         gstate->player_pos[i] = (next() % (nPositions - N_TARGETS)) + N_TARGETS;
         gstate->player_targets_left[i] = N_TARGETS_PLAYER;
     }
-    // Re-shuffle player order
+    // Reset & re-shuffle player order (such that new game only depends
+    // on state of RNG)
+    for (i = 0; i < gstate->nPlayers; ++i) {
+        gstate->player_order[i] = i;
+    }
     shuffle(gstate->player_order, gstate->nPlayers);
     // Reset (static) targets
-    //for (i = 0; i < N_TARGETS; ++i) {
-    //    gstate->targets[i] = i;
-    //}
+    for (i = 0; i < N_TARGETS; ++i) {
+        gstate->targets[i] = i;
+    }
     // Randomly re-shuffle targets
     shuffle(gstate->targets, N_TARGETS);
     // Re-initialize player targets
@@ -368,6 +646,26 @@ void GameState_reset(GameState_t *gstate, unsigned int nPositions) {
     gstate->boeg_pos = gstate->targets[iter];
     // Reset id of Boeg
     gstate->boeg_id = BOEG_ID_DEFAULT;
+    // Re-compute hash
+    gstate->hash = GameState_hash(gstate);
+}
+
+// Copy state of game into dst, which must have been initialized for the
+// same number of players (auxiliary buffers & dice stream are not shared)
+void GameState_copy(GameState_t *dst, const GameState_t *src) {
+    assert(dst->nPlayers == src->nPlayers);
+    const unsigned int nPlayers = src->nPlayers;
+    
+    memcpy(dst->targets, src->targets, sizeof(src->targets));
+    memcpy(dst->player_pos, src->player_pos, nPlayers * sizeof(unsigned int));
+    memcpy(dst->player_targets, src->player_targets, 
+           nPlayers * N_TARGETS_PLAYER * sizeof(unsigned int));
+    memcpy(dst->player_targets_left, src->player_targets_left,
+           nPlayers * sizeof(unsigned int));
+    memcpy(dst->player_order, src->player_order, nPlayers * sizeof(unsigned int));
+    dst->boeg_pos = src->boeg_pos;
+    dst->boeg_id = src->boeg_id;
+    dst->hash = src->hash;
 }
 
 // Print all relevant information about current state of game
@@ -421,12 +719,20 @@ void GameState_info(const BoardInfo_t *binfo, const GameState_t *gstate,
 void BoardInfo_free(BoardInfo_t *binfo) {
     assert(binfo != NULL);
     
+    // Tables may still be computed (BoardInfo_init_lazy)
+    _BoardInfo_join(binfo->init);
+    pthread_mutex_destroy(&binfo->init->mutex);
+    free(binfo->init);
+    Strategy_board_free(binfo);
+    free(binfo->board_dir);
     free(binfo->locations);
     free(binfo->locations_sorted);
     free(binfo->dist_player);
     free(binfo->dist_boeg);
     free(binfo->par_player);
     free(binfo->par_boeg);
+    ReachTable_free(&binfo->reach_player);
+    ReachTable_free(&binfo->reach_boeg);
     // Clean up graphs
     Graph_free(&binfo->graph);
 }
@@ -441,12 +747,117 @@ void GameState_free(GameState_t *gstate) {
     // Clean up auxiliary buffers
     free(gstate->visited_buf);
     free(gstate->distances_buf);
+    free(gstate->moves_buf);
+    Strategy_thread_free(gstate);
+}
+
+// Tables of GREEDY are only built for boards up to this many positions
+// (2 * DIE_SIZE * n^2 entries); larger boards follow the parents instead
+#ifndef GREEDY_TOWARD_MAX_POSITIONS
+#define GREEDY_TOWARD_MAX_POSITIONS (512)
+#endif
+
+// Per-board context of GREEDY: position after moving d steps along the
+// shortest path from source towards destination (d = 1..DIE_SIZE), i.e.
+// follow_path as a single lookup. The destination itself if it is at
+// most d steps away. Tables are built by the first move of GREEDY on the
+// board (see _Greedy_tables), not for boards no one plays GREEDY on
+typedef struct {
+    const BoardInfo_t *binfo;
+    pthread_mutex_t lock;
+    atomic_bool built;            // tables below are valid
+    unsigned int *toward_player;  // [(d - 1) * n * n + source * n + dest]
+    unsigned int *toward_boeg;    // (NULL: board too large)
+} _GreedyBoard;
+
+static unsigned int *_Greedy_toward_table(const BoardInfo_t *binfo,
+                                          const int *dist, const int *parents)
+{
+    const size_t n = binfo->nPositions;
+    unsigned int *toward = (unsigned int *) malloc(DIE_SIZE * n * n * sizeof(unsigned int));
+    assert(toward != NULL);
+    for (size_t source = 0; source < n; ++source) {
+        const size_t offset = source * n;
+        for (size_t dest = 0; dest < n; ++dest) {
+            unsigned int pos = dest;
+            // Walk back from destination, starting with largest d
+            for (int d = DIE_SIZE; d >= 1; --d) {
+                while (dist[offset + pos] > d)
+                    pos = parents[offset + pos];
+                toward[(d - 1) * n * n + offset + dest] = pos;
+            }
+        }
+    }
+    return toward;
+}
+
+static void *_Greedy_board_init(const BoardInfo_t *binfo)
+{
+    _GreedyBoard *board = (_GreedyBoard *) malloc(sizeof(_GreedyBoard));
+    assert(board != NULL);
+    board->binfo = binfo;
+    pthread_mutex_init(&board->lock, NULL);
+    atomic_init(&board->built, false);
+    board->toward_player = NULL;
+    board->toward_boeg = NULL;
+    return board;
+}
+
+static void _Greedy_board_free(void *ctx)
+{
+    _GreedyBoard *board = (_GreedyBoard *) ctx;
+    free(board->toward_player);
+    free(board->toward_boeg);
+    pthread_mutex_destroy(&board->lock);
+    free(board);
+}
+
+// Context of GREEDY with tables built (once, by the first caller; safe to
+// call concurrently)
+static inline const _GreedyBoard *_Greedy_tables(const void *ctx)
+{
+    // Context is shared read-only, apart from building the tables once
+    _GreedyBoard *board = (_GreedyBoard *) ctx;
+    if (atomic_load_explicit(&board->built, memory_order_acquire))
+        return board;
+    pthread_mutex_lock(&board->lock);
+    if (!atomic_load_explicit(&board->built, memory_order_relaxed)) {
+        const BoardInfo_t *binfo = board->binfo;
+        if (binfo->nPositions <= GREEDY_TOWARD_MAX_POSITIONS) {
+            const uint64_t span = Trace_begin();
+            board->toward_player = _Greedy_toward_table(binfo,
+                    binfo->dist_player, binfo->par_player);
+            board->toward_boeg = _Greedy_toward_table(binfo,
+                    binfo->dist_boeg, binfo->par_boeg);
+            Trace_end("greedy tables", span);
+        }
+        atomic_store_explicit(&board->built, true, memory_order_release);
+    }
+    pthread_mutex_unlock(&board->lock);
+    return board;
+}
+
+// Position after moving d steps from source towards dest (follows parents
+// if there is no table)
+static inline unsigned int _Greedy_toward(const BoardInfo_t *binfo,
+        const unsigned int *toward, const int *dist, const int *parents,
+        unsigned int source, unsigned int dest, int d)
+{
+    const size_t n = binfo->nPositions;
+    if (__builtin_expect(toward != NULL, 1))
+        return toward[(d - 1) * n * n + source * n + dest];
+    if (dist[source * n + dest] <= d)
+        return dest;
+    return follow_path(parents, source, dest, n, d);
 }
 
 // GREEDY STRATEGY:
 // Always move to closest target using shortest path
-enum STATUS GameState_move_greedy(const BoardInfo_t *binfo, 
-            GameState_t *gstate, unsigned int player_id, bool verbose) {
+enum STATUS GameState_move_greedy(const BoardInfo_t *binfo,
+            const StrategyCtx_t *ctx, GameState_t *gstate,
+            unsigned int player_id, const AvoidParams_t *params, bool verbose) {
+    const _GreedyBoard *board = _Greedy_tables(ctx->board);
+    (void) params;
     unsigned int i, j, offset_targets;
     unsigned int target, min_target = N_TARGETS;
     int dist, min_dist = RAND_MAX;
@@ -455,9 +866,10 @@ enum STATUS GameState_move_greedy(const BoardInfo_t *binfo,
     // Offset in distances/parents array
     unsigned int offset_board;
     // Roll dice
-    int dice_roll = roll_dice();
-    printf("\n%sDice Roll: %d%s\n\n", PLAYER_COLORS[player_id], 
-        dice_roll, DEFAULT_COLOR);
+    int dice_roll = roll_dice(gstate);
+    if (verbose)
+        printf("\n%sDice Roll: %d%s\n\n", PLAYER_COLORS[player_id], 
+            dice_roll, DEFAULT_COLOR);
     // Check if playing as Boeg
     if (player_id == gstate->boeg_id) {
         
@@ -489,9 +901,10 @@ enum STATUS GameState_move_greedy(const BoardInfo_t *binfo,
                         DEFAULT_COLOR, binfo->locations[target].name);
                 }
                 // Move Boeg to this target
-                gstate->boeg_pos = target;
+                gstate->move_path = PATH_TARGET;
+                GameState_set_boeg_pos(gstate, target);
                 // Update targets (invalidate & decrement)
-                gstate->player_targets[offset_targets + i] = N_TARGETS;
+                GameState_clear_target(gstate, offset_targets + i);
                 // Check if player has finished
                 if (--gstate->player_targets_left[player_id] == 0)
                     return GAMEOVER;
@@ -504,10 +917,12 @@ enum STATUS GameState_move_greedy(const BoardInfo_t *binfo,
                 min_target = target;
             }
         }
+        gstate->move_path = PATH_FOLLOW;
         if (min_target != N_TARGETS) {
             // Try to move as far as possible to closest (min) target
-            closest_pos = follow_path(binfo->par_boeg, gstate->boeg_pos, min_target,
-                binfo->nPositions, dice_roll);
+            closest_pos = _Greedy_toward(binfo, board->toward_boeg,
+                binfo->dist_boeg, binfo->par_boeg, gstate->boeg_pos,
+                min_target, dice_roll);
         }
         // EDGE CASE: Check if already occupied by opponent(s)
         if (min_target == N_TARGETS || opponent_at_target(gstate, closest_pos, player_id)) {
@@ -515,25 +930,21 @@ enum STATUS GameState_move_greedy(const BoardInfo_t *binfo,
             // that is as close as possible
             if (verbose)
                 printf("Occupied...\n");
+            gstate->move_path = PATH_FALLBACK;
                 
             closest_pos = binfo->nPositions;
             // Consider all possible locations that are in reach
             unsigned int offset;
             int sum_dists;
             int min_sum = RAND_MAX;
-            // Obtain HashMap of all reachable positions from current pos
-            // in exactly 'dice_roll' steps
-            HashMap reachablePos;
-            reachablePos = Graph_reachable_pos(&binfo->graph,
-                                               true,
-                                               gstate->boeg_pos, dice_roll,
-                                               gstate->visited_buf, 
-                                               gstate->distances_buf);
+            // All positions reachable from current pos in exactly
+            // 'dice_roll' steps (precomputed)
+            unsigned int current, nReachable;
+            const unsigned int *reachable = ReachTable_get(&binfo->reach_boeg,
+                    gstate->boeg_pos, dice_roll, &nReachable);
             // Iterate over all reachable positions
-            size_t current;
-            const size_t nReachable = HashMap_size(&reachablePos);
             for (current = 0; current < nReachable; ++current) {
-                j = HashMap_get(&reachablePos, current);
+                j = reachable[current];
                 // Make sure no opponent is already at current pos
                 if (!opponent_at_target(gstate, j, player_id)) {
                     // Compute offset
@@ -567,7 +978,7 @@ enum STATUS GameState_move_greedy(const BoardInfo_t *binfo,
                     gstate->boeg_pos, closest_pos, binfo->nPositions,
                     dice_roll, DEFAULT_COLOR);
             }
-            gstate->boeg_pos = closest_pos;
+            GameState_set_boeg_pos(gstate, closest_pos);
             
         } else {
             // Otherwise stay at current position
@@ -589,9 +1000,10 @@ enum STATUS GameState_move_greedy(const BoardInfo_t *binfo,
                             dist, PLAYER_COLORS[player_id]);
             }
             // Move player to Boeg
-            gstate->player_pos[player_id] = gstate->boeg_pos;
+            gstate->move_path = PATH_TARGET;
+            GameState_set_player_pos(gstate, player_id, gstate->boeg_pos);
             // Update Boeg id
-            gstate->boeg_id = player_id;
+            GameState_set_boeg_id(gstate, player_id);
             // Check if capture position happens to be active target of player
             if (is_active_target(gstate, gstate->boeg_pos, player_id)) {
                 // Player visited this target
@@ -602,23 +1014,63 @@ enum STATUS GameState_move_greedy(const BoardInfo_t *binfo,
             return AGAIN;
         }
         // Move as close as possible to boeg
+        gstate->move_path = PATH_FOLLOW;
+        unsigned int new_pos;
         if (verbose) {
-            gstate->player_pos[player_id] = print_path(binfo->par_player, binfo->locations, 
+            new_pos = print_path(binfo->par_player, binfo->locations, 
                             current_pos, gstate->boeg_pos, binfo->nPositions,
                             dice_roll, PLAYER_COLORS[player_id]);
         } else {
-            gstate->player_pos[player_id] = follow_path(binfo->par_player, 
-                    current_pos, gstate->boeg_pos, binfo->nPositions, dice_roll);
+            new_pos = _Greedy_toward(binfo, board->toward_player,
+                    binfo->dist_player, binfo->par_player, current_pos,
+                    gstate->boeg_pos, dice_roll);
         }
+        GameState_set_player_pos(gstate, player_id, new_pos);
         return CONTINUE;
     }
 }
 
+// Per-board context of AVOIDANT: threat map, i.e. inverse distance from
+// opponent to candidate position, split by whether the opponent can reach
+// the position within one dice roll (far threats are lessened by factor)
+typedef struct {
+    double *near;  // [opp_pos * nPositions + pos]
+    double *far;
+} _AvoidantBoard;
+
+static void *_Avoidant_board_init(const BoardInfo_t *binfo)
+{
+    const unsigned int n = binfo->nPositions;
+    _AvoidantBoard *board = (_AvoidantBoard *) malloc(sizeof(_AvoidantBoard));
+    assert(board != NULL);
+    board->near = (double *) malloc(n * n * sizeof(double));
+    assert(board->near != NULL);
+    board->far = (double *) malloc(n * n * sizeof(double));
+    assert(board->far != NULL);
+    for (unsigned int i = 0; i < n * n; ++i) {
+        const int dist = binfo->dist_player[i];
+        // Occupied positions are never candidates
+        const double inv = dist == 0 ? 0.0 : 1.0 / dist;
+        board->near[i] = dist > DIE_SIZE ? 0.0 : inv;
+        board->far[i] = dist > DIE_SIZE ? inv : 0.0;
+    }
+    return board;
+}
+
+static void _Avoidant_board_free(void *ctx)
+{
+    _AvoidantBoard *board = (_AvoidantBoard *) ctx;
+    free(board->near);
+    free(board->far);
+    free(board);
+}
+
 // Avoid opponents when playing as Boeg, while still minimizing
 // distance to targets left
-enum STATUS GameState_move_avoidant(const BoardInfo_t *binfo, 
-        GameState_t *gstate, unsigned int player_id, 
-        double base_avoidance, bool verbose) {
+enum STATUS GameState_move_avoidant(const BoardInfo_t *binfo,
+        const StrategyCtx_t *ctx, GameState_t *gstate,
+        unsigned int player_id, const AvoidParams_t *params, bool verbose) {
+    const _AvoidantBoard *board = (const _AvoidantBoard *) ctx->board;
     unsigned int i, j, offset_targets;
     unsigned int target;
     int dist;
@@ -627,9 +1079,10 @@ enum STATUS GameState_move_avoidant(const BoardInfo_t *binfo,
     // Offset in distances/parents array
     unsigned int offset_board;
     // Roll dice
-    int dice_roll = roll_dice();
-    printf("\n%sDice Roll: %d%s\n\n", PLAYER_COLORS[player_id], 
-        dice_roll, DEFAULT_COLOR);
+    int dice_roll = roll_dice(gstate);
+    if (verbose)
+        printf("\n%sDice Roll: %d%s\n\n", PLAYER_COLORS[player_id], 
+            dice_roll, DEFAULT_COLOR);
     // Check if playing as Boeg
     if (player_id == gstate->boeg_id) {
         
@@ -661,9 +1114,10 @@ enum STATUS GameState_move_avoidant(const BoardInfo_t *binfo,
                         DEFAULT_COLOR, binfo->locations[target].name);
                 }
                 // Move Boeg to this target
-                gstate->boeg_pos = target;
+                gstate->move_path = PATH_TARGET;
+                GameState_set_boeg_pos(gstate, target);
                 // Update targets (invalidate & decrement)
-                gstate->player_targets[offset_targets + i] = N_TARGETS;
+                GameState_clear_target(gstate, offset_targets + i);
                 // Check if player has finished
                 if (--gstate->player_targets_left[player_id] == 0)
                     return GAMEOVER;
@@ -674,27 +1128,24 @@ enum STATUS GameState_move_avoidant(const BoardInfo_t *binfo,
         // Try to move to different location 'dice_roll' away
         // that is as close as possible to targets, while maintaining
         // distance to opponents -> minimize objective
+        gstate->move_path = PATH_FALLBACK;
         optimal_pos = binfo->nPositions;
         // Calculate avoidance based on how many targets are cleared
         const double targets_left = gstate->player_targets_left[player_id];
-        const double avoidance = base_avoidance * targets_left / N_TARGETS_PLAYER;
+        const double avoidance = params->base_avoidance * targets_left / N_TARGETS_PLAYER;
+        const double inv_far_factor = 1.0 / params->far_factor;
         // Consider all possible locations that are in reach
         unsigned int offset;
         double objective;
         double min_objective = INFINITY;
-        // Obtain HashMap of all reachable positions from current pos
-        // in exactly 'dice_roll' steps
-        HashMap reachablePos;
-        reachablePos = Graph_reachable_pos(&binfo->graph,
-                                           true,
-                                           gstate->boeg_pos, dice_roll,
-                                           gstate->visited_buf, 
-                                           gstate->distances_buf);
+        // All positions reachable from current pos in exactly
+        // 'dice_roll' steps (precomputed)
+        unsigned int current, nReachable;
+        const unsigned int *reachable = ReachTable_get(&binfo->reach_boeg,
+                gstate->boeg_pos, dice_roll, &nReachable);
         // Iterate over all reachable positions and evaluate objective
-        size_t current;
-        const size_t nReachable = HashMap_size(&reachablePos);
         for (current = 0; current < nReachable; ++current) {
-            j = HashMap_get(&reachablePos, current);
+            j = reachable[current];
             // Make sure no opponent is already at current pos
             if (!opponent_at_target(gstate, j, player_id)) {
                 // Compute offset
@@ -720,22 +1171,13 @@ enum STATUS GameState_move_avoidant(const BoardInfo_t *binfo,
                             !is_active_player(gstate, i)) {
                         continue;
                     }
-                    unsigned int opp_pos = gstate->player_pos[i];
-                    // Compute shortest distance from opponent to
-                    // candidate position
-                    int opp_dist = binfo->dist_player[opp_pos * binfo->nPositions + j];
-                    // DEBUG
-                    assert(opp_dist != 0);
-                    double denom = (double)opp_dist;
-                    // Check if opponent cannot reach this position
-                    // within one dice roll
-                    if (opp_dist > DIE_SIZE) {
-                        // Lessen penalty in objective in this case
-                        // -> larger denominator
-                        denom = 2. * denom;
-                    }
+                    // Threat of opponent at candidate position (penalty
+                    // is lessened if opponent cannot reach it within one
+                    // dice roll)
+                    const unsigned int k = gstate->player_pos[i] * binfo->nPositions + j;
                     // Update objective (parameterized)
-                    objective += avoidance / denom;
+                    objective += avoidance *
+                            (board->near[k] + inv_far_factor * board->far[k]);
                 }
                 // Update optimal pos based on objective value
                 if (objective < min_objective) {
@@ -754,7 +1196,7 @@ enum STATUS GameState_move_avoidant(const BoardInfo_t *binfo,
                             gstate->boeg_pos, optimal_pos, binfo->nPositions,
                             dice_roll, DEFAULT_COLOR);
             }
-            gstate->boeg_pos = optimal_pos;
+            GameState_set_boeg_pos(gstate, optimal_pos);
             
         } else {
             // Otherwise stay at current position
@@ -777,9 +1219,10 @@ enum STATUS GameState_move_avoidant(const BoardInfo_t *binfo,
                             dist, PLAYER_COLORS[player_id]);
             }
             // Move player to Boeg
-            gstate->player_pos[player_id] = gstate->boeg_pos;
+            gstate->move_path = PATH_TARGET;
+            GameState_set_player_pos(gstate, player_id, gstate->boeg_pos);
             // Update Boeg id
-            gstate->boeg_id = player_id;
+            GameState_set_boeg_id(gstate, player_id);
              // Check if capture position happens to be active target of player
             if (is_active_target(gstate, gstate->boeg_pos, player_id)) {
                 // Player visited this target
@@ -790,18 +1233,190 @@ enum STATUS GameState_move_avoidant(const BoardInfo_t *binfo,
             return AGAIN;
         }
         // Move as close as possible to boeg
+        gstate->move_path = PATH_FOLLOW;
+        unsigned int new_pos;
         if (verbose) {
-            gstate->player_pos[player_id] = print_path(binfo->par_player, binfo->locations, 
+            new_pos = print_path(binfo->par_player, binfo->locations, 
                             current_pos, gstate->boeg_pos, binfo->nPositions,
                             dice_roll, PLAYER_COLORS[player_id]);
         } else {
-            gstate->player_pos[player_id] = follow_path(binfo->par_player, 
+            new_pos = follow_path(binfo->par_player, 
                     current_pos, gstate->boeg_pos, binfo->nPositions, dice_roll);
         }
+        GameState_set_player_pos(gstate, player_id, new_pos);
         return CONTINUE;
     }
 }
-                            
+
+static const Strategy_t STRATEGY_GREEDY = {
+    .name = "GREEDY",
+    .init = _Greedy_board_init,
+    .free = _Greedy_board_free,
+    .thread_init = NULL,
+    .thread_free = NULL,
+    .move = GameState_move_greedy
+};
+
+static const Strategy_t STRATEGY_AVOIDANT = {
+    .name = "AVOIDANT",
+    .init = _Avoidant_board_init,
+    .free = _Avoidant_board_free,
+    .thread_init = NULL,
+    .thread_free = NULL,
+    .move = GameState_move_avoidant
+};
+
+// Defined by expectimax.h, mcts.h & endgame.h (below)
+static const Strategy_t STRATEGY_EXPECTIMAX;
+static const Strategy_t STRATEGY_MCTS;
+static const Strategy_t STRATEGY_ENDGAME;
+
+// USER_COMMAND has no entry (see GameState_move_command)
+static const Strategy_t *STRATEGY_TABLE[N_STRATEGIES] = {
+    [GREEDY] = &STRATEGY_GREEDY,
+    [AVOIDANT] = &STRATEGY_AVOIDANT,
+    [EXPECTIMAX] = &STRATEGY_EXPECTIMAX,
+    [MCTS] = &STRATEGY_MCTS,
+    [ENDGAME] = &STRATEGY_ENDGAME
+};
+
+// Carry out a move to a destination that is known to be valid for the
+// given dice roll, without any checks or output. Staying at the current
+// position corresponds to skipping the turn
+enum STATUS GameState_apply_move(const BoardInfo_t *binfo,
+                                 GameState_t *gstate,
+                                 unsigned int player_id,
+                                 unsigned int destination,
+                                 int dice_roll)
+{
+    unsigned int i, target, offset_board, offset_targets;
+    int dist;
+    
+    if (player_id == gstate->boeg_id) {  // playing as boeg
+        
+        offset_board = gstate->boeg_pos * binfo->nPositions;
+        offset_targets = player_id * N_TARGETS_PLAYER;
+        // See if destination corresponds to target location
+        for (i = 0; i < N_TARGETS_PLAYER; ++i) {
+            target = gstate->player_targets[offset_targets + i];
+            // Check if target is already visited
+            if (target == N_TARGETS) {
+                continue;
+            }
+            // Distance from boeg position to target
+            dist = binfo->dist_boeg[offset_board + target];
+            if (destination == target && dice_roll >= dist) {
+                // Move Boeg to this target
+                GameState_set_boeg_pos(gstate, target);
+                // Update targets (invalidate & decrement)
+                GameState_clear_target(gstate, offset_targets + i);
+                // Check if player has finished
+                if (--gstate->player_targets_left[player_id] == 0)
+                    return GAMEOVER;
+                    
+                return CONTINUE;
+            }
+        }
+        // Otherwise, move boeg to requested position
+        GameState_set_boeg_pos(gstate, destination);
+        return CONTINUE;
+        
+    } else {
+        
+        offset_board = gstate->player_pos[player_id] * binfo->nPositions;
+        // Distance from current position of player to boeg
+        dist = binfo->dist_player[offset_board + gstate->boeg_pos];
+        // Check if player captures boeg
+        if (destination == gstate->boeg_pos && dice_roll >= dist) {
+            // Move player to Boeg
+            GameState_set_player_pos(gstate, player_id, gstate->boeg_pos);
+            // Update Boeg id
+            GameState_set_boeg_id(gstate, player_id);
+             // Check if capture position happens to be active target of player
+            if (is_active_target(gstate, gstate->boeg_pos, player_id)) {
+                // Player visited this target
+                if (--gstate->player_targets_left[player_id] == 0)
+                    return GAMEOVER;
+            }
+            // Make next move as Boeg
+            return AGAIN;
+        }
+        // Otherwise, move player to requested position
+        GameState_set_player_pos(gstate, player_id, destination);
+        return CONTINUE;
+    }
+}
+
+// Write all valid destinations of player for given dice roll into moves
+// (at least nPositions + N_TARGETS_PLAYER entries) and return their number.
+// If there are no valid moves, the only destination is the current position
+unsigned int GameState_legal_moves(const BoardInfo_t *binfo,
+                                   const GameState_t *gstate,
+                                   unsigned int player_id, int dice_roll,
+                                   unsigned int *moves)
+{
+    unsigned int i, j, target, nReachable, nMoves = 0;
+    const unsigned int *reachable;
+    int dist;
+    
+    if (player_id == gstate->boeg_id) {  // playing as boeg
+        
+        const unsigned int offset_board = gstate->boeg_pos * binfo->nPositions;
+        const unsigned int offset_targets = player_id * N_TARGETS_PLAYER;
+        // Unoccupied targets reachable within dice_roll steps
+        for (i = 0; i < N_TARGETS_PLAYER; ++i) {
+            target = gstate->player_targets[offset_targets + i];
+            if (target == N_TARGETS) {
+                continue;
+            }
+            dist = binfo->dist_boeg[offset_board + target];
+            if (dice_roll >= dist && !opponent_at_target(gstate, target, player_id)) {
+                moves[nMoves++] = target;
+            }
+        }
+        // Unoccupied positions reachable in exactly dice_roll steps
+        reachable = ReachTable_get(&binfo->reach_boeg, gstate->boeg_pos,
+                                   dice_roll, &nReachable);
+        for (i = 0; i < nReachable; ++i) {
+            if (opponent_at_target(gstate, reachable[i], player_id)) {
+                continue;
+            }
+            // Skip targets already added above
+            for (j = 0; j < N_TARGETS_PLAYER; ++j) {
+                if (gstate->player_targets[offset_targets + j] == reachable[i])
+                    break;
+            }
+            if (j == N_TARGETS_PLAYER) {
+                moves[nMoves++] = reachable[i];
+            }
+        }
+        // No valid moves -> skip turn
+        if (nMoves == 0) {
+            moves[nMoves++] = gstate->boeg_pos;
+        }
+    } else {
+        
+        const unsigned int player_pos = gstate->player_pos[player_id];
+        // Boeg, if reachable within dice_roll steps
+        dist = binfo->dist_player[player_pos * binfo->nPositions + gstate->boeg_pos];
+        if (dice_roll >= dist) {
+            moves[nMoves++] = gstate->boeg_pos;
+        }
+        // Positions reachable in exactly dice_roll steps
+        reachable = ReachTable_get(&binfo->reach_player, player_pos,
+                                   dice_roll, &nReachable);
+        for (i = 0; i < nReachable; ++i) {
+            if (reachable[i] != gstate->boeg_pos) {
+                moves[nMoves++] = reachable[i];
+            }
+        }
+        if (nMoves == 0) {
+            moves[nMoves++] = player_pos;
+        }
+    }
+    return nMoves;
+}
+
 enum STATUS GameState_move_command(const BoardInfo_t *binfo, 
                                    GameState_t *gstate, 
                                    unsigned int player_id, 
@@ -886,21 +1501,15 @@ enum STATUS GameState_move_command(const BoardInfo_t *binfo,
             dist = binfo->dist_boeg[offset_board + target];
             if (destination == target && dice_roll >= dist) {
                 // Move Boeg to this target
-                gstate->boeg_pos = target;
-                // Update targets (invalidate & decrement)
-                gstate->player_targets[offset_targets + i] = N_TARGETS;
-                // Check if player has finished
-                if (--gstate->player_targets_left[player_id] == 0)
-                    return GAMEOVER;
-                    
-                return CONTINUE;
+                return GameState_apply_move(binfo, gstate, player_id,
+                                            destination, dice_roll);
             }
         }
         // Check if destination is reachable in exactly dice_roll steps
         if (HashMap_find(&reachablePos, destination)) {
             // Otherwise, move boeg to requested position
-            gstate->boeg_pos = destination;
-            return CONTINUE;
+            return GameState_apply_move(binfo, gstate, player_id,
+                                        destination, dice_roll);
         } else {
             min_dist = binfo->dist_boeg[offset_board + destination];
             printf("\nCannot reach '%s' from '%s' using %d step(s) (min. is %d)\n",
@@ -929,23 +1538,14 @@ enum STATUS GameState_move_command(const BoardInfo_t *binfo,
         // Check if player can reach boeg
         if (destination == gstate->boeg_pos && dice_roll >= dist) {
             // Move player to Boeg
-            gstate->player_pos[player_id] = gstate->boeg_pos;
-            // Update Boeg id
-            gstate->boeg_id = player_id;
-             // Check if capture position happens to be active target of player
-            if (is_active_target(gstate, gstate->boeg_pos, player_id)) {
-                // Player visited this target
-                if (--gstate->player_targets_left[player_id] == 0)
-                    return GAMEOVER;
-            }
-            // Make next move as Boeg
-            return AGAIN;
+            return GameState_apply_move(binfo, gstate, player_id,
+                                        destination, dice_roll);
         }
         // Check if end_pos is reachable in exactly dice_roll steps
         if (HashMap_find(&reachablePos, destination)) {
             // Otherwise, move player to requested position
-            gstate->player_pos[player_id] = destination;
-            return CONTINUE;
+            return GameState_apply_move(binfo, gstate, player_id,
+                                        destination, dice_roll);
         } else {
             min_dist = binfo->dist_player[player_pos * binfo->nPositions + destination];
             printf("\nCannot reach '%s' from '%s' using %d step(s) (min. is %d)\n",
@@ -957,34 +1557,66 @@ enum STATUS GameState_move_command(const BoardInfo_t *binfo,
     }
 }
 
-// Make move based on provided strategy
+// Table based & search strategies (need definitions above)
+#include "endgame.h"
+#include "expectimax.h"
+#include "mcts.h"
+
+// Dispatch move to strategy (INVALID for USER_COMMAND)
+static enum STATUS _GameState_dispatch_move(const BoardInfo_t *binfo,
+        GameState_t *gstate, unsigned int player_id, const AvoidParams_t *params,
+        enum MOVE_STRATEGY move_strat, bool verbose) {
+    if (STRATEGY_TABLE[move_strat] == NULL)
+        return INVALID;
+    return Strategy_move(binfo, gstate, player_id, params, move_strat, verbose);
+}
+
+// Make move based on provided strategy (latency is recorded if game state
+// has histograms attached)
 enum STATUS GameState_move(const BoardInfo_t *binfo, GameState_t *gstate, 
-                            unsigned int player_id, double base_avoidance,
+                            unsigned int player_id, const AvoidParams_t *params,
                                 enum MOVE_STRATEGY move_strat, bool verbose) {
-    switch (move_strat) {
-        case GREEDY:
-            return GameState_move_greedy(binfo, gstate, player_id, verbose);
-        case AVOIDANT:
-            return GameState_move_avoidant(binfo, gstate, player_id, base_avoidance, verbose);
-        default:
-            return INVALID;
-    }
+    if (gstate->timing == NULL)
+        return _GameState_dispatch_move(binfo, gstate, player_id, params,
+                                        move_strat, verbose);
+    const bool isBoeg = player_id == gstate->boeg_id;
+    gstate->move_path = PATH_SEARCH;  // unless reported by strategy
+    const uint64_t start = MoveTiming_now();
+    const enum STATUS status = _GameState_dispatch_move(binfo, gstate, player_id,
+            params, move_strat, verbose);
+    MoveTiming_record(gstate->timing, move_strat, isBoeg, gstate->move_path,
+                      MoveTiming_now() - start);
+    return status;
 }
 
+// Let player take its turn, which includes moving again as Boeg after
+// capturing it
+enum STATUS GameState_play_turn(const BoardInfo_t *binfo, GameState_t *gstate,
+                                unsigned int player_id, const AvoidParams_t *params,
+                                enum MOVE_STRATEGY move_strat, bool verbose) {
+    enum STATUS status;
+    do {
+        status = GameState_move(binfo, gstate, player_id, params,
+                                move_strat, verbose);
+    } while (status == AGAIN);
+    return status;
+}
+
+// Resumable turn progression (needs GameState_move & GameResult_t)
+#include "game_stepper.h"
+
 // Run game for at most MAX_TURNS
 GameResult_t GameState_run(const BoardInfo_t *binfo, GameState_t *gstate, 
         const enum MOVE_STRATEGY *player_strategies, 
+        const AvoidParams_t *player_params,
         bool stop_at_first, bool verbose) {
-    int winner = -1;
-    unsigned int i, j;
+    unsigned int i;
     unsigned int player_id;
-    unsigned int nTurns = 1;
-    enum STATUS status;
+    unsigned int nTurns = 0;
     enum MOVE_STRATEGY move_strat;
-    // Special game parameter
-    const double base_avoidance = 40.0;
-    unsigned int ranking[MAX_PLAYERS] = {0};
-    unsigned int nFinished = 0;  // how many players have finished
+    GameStepper_t stepper;
+    BoardInfo_wait(binfo);
+    const uint64_t span_game = Trace_begin();
     
     if (verbose) {
         printf("--Beginning Game--\n\n");
@@ -1013,136 +1645,400 @@ GameResult_t GameState_run(const BoardInfo_t *binfo, GameState_t *gstate,
         }
     }
     
-    while (nTurns < MAX_TURNS) {
-        if (verbose)
-            printf("\nRound: %u\n", nTurns);
+    GameStepper_init(&stepper, gstate, stop_at_first);
+    while (!stepper.done) {
+        if (verbose && stepper.nTurns != nTurns)
+            printf("\nRound: %u\n", stepper.nTurns);
+        nTurns = stepper.nTurns;
         
-        // All players that are actively playing make their move
-        for (i = 0; i < gstate->nPlayers; ++i) {
-            player_id = gstate->player_order[i];
-            // If player has already finished, move on to next player
-            if (!is_active_player(gstate, player_id)) {
-                continue;
-            }
-            // Retrieve strategy of current player
-            move_strat = player_strategies[player_id];
-            // Print board info
-            if (move_strat == USER_COMMAND) {
-                printf("\nBoard info:\n");
-                // Print current state of game
-                GameState_info(binfo, gstate, player_id);
-            }
-            // Player makes move
-            status = GameState_move(binfo, gstate, player_id, base_avoidance, 
-                move_strat, verbose);
-            // DEBUG
-            assert(status != INVALID);
-            // Check if game is over
-            if (status == GAMEOVER) {
-                if (nFinished == 0) {
-                    // First player to reach game over is winner
-                    winner = player_id;
-                    // Check if overall game should be over
-                    if (stop_at_first) goto end;
-                }
-                // Reset boeg ID to default
-                assert(player_id == gstate->boeg_id);
-                gstate->boeg_id = BOEG_ID_DEFAULT;
-                // Update ranking of players
-                ranking[nFinished++] = player_id;
-                
-                if (nFinished == gstate->nPlayers - 1) {
-                    // Determine last place
-                    for (j = 0; j < gstate->nPlayers; ++j) {
-                        if (is_active_player(gstate, j)) {
-                            ranking[nFinished++] = j;
-                            break;  // found
-                        }
-                    }
-                    
-                    // Game is decided -> QUIT
-                    goto end;
-                }
-            }
+        // Print board info at beginning of turn
+        player_id = GameStepper_player(&stepper, gstate);
+        if (!stepper.midTurn && player_strategies[player_id] == USER_COMMAND) {
+            printf("\nBoard info:\n");
+            // Print current state of game
+            GameState_info(binfo, gstate, player_id);
         }
-        
-        ++nTurns;
+        // Player makes move
+        const uint64_t span = Trace_begin();
+        GameStepper_step(binfo, &stepper, gstate, player_strategies,
+                         player_params, verbose);
+        Trace_end("turn", span);
     }
+    Trace_end("GameState_run", span_game);
     
-end:
+    GameResult_t result = GameStepper_result(&stepper);
     // Check if maximum turns reached AND no player finished
-    if (winner == -1 && nTurns == MAX_TURNS) {
+    if (result.winner == -1 && result.nTurns == MAX_TURNS) {
         fprintf(stderr, "\nReached maximum turns!\n");
     } else if (verbose) {
-        assert(winner != -1);
+        assert(result.winner != -1);
         // Print result of game
-        printf("\nWINNER: %sPlayer %u%s\n", PLAYER_COLORS[winner],
-                        winner+1, DEFAULT_COLOR);
-        for (i = 1; i < nFinished; ++i) {
-            player_id = ranking[i];
+        printf("\nWINNER: %sPlayer %u%s\n", PLAYER_COLORS[result.winner],
+                        result.winner+1, DEFAULT_COLOR);
+        for (i = 1; i < result.nRanked; ++i) {
+            player_id = result.ranking[i];
             printf("%u. Place: %sPlayer %u%s\n", i+1, 
                 PLAYER_COLORS[player_id], player_id+1, DEFAULT_COLOR);
         }
     }
-    return (GameResult_t) {.winner=winner, .nTurns=nTurns};
+    return result;
 }
 
-// Compute statistics (max., min. & avg. #turns as well as #wins of
-// individual players)
-int GameState_statistics(const BoardInfo_t *binfo, GameState_t *gstate, 
-        const enum MOVE_STRATEGY *player_strategies, unsigned int nGames) {
+// Lockstep simulation of many GREEDY games (needs GameResult_t)
+#include "batch_sim.h"
+// Accumulators of simulation results (need GameResult_t)
+#include "sim_stats.h"
+// Checkpoints of statistics runs (need SimStats_t)
+#include "checkpoint.h"
+
+// Games per block: games of a block are accumulated in order of their
+// index, blocks are merged along a fixed tree per round
+#ifndef SIM_BLOCK_GAMES
+#define SIM_BLOCK_GAMES (256)
+#endif
+#ifndef SIM_ROUND_BLOCKS
+#define SIM_ROUND_BLOCKS (64)
+#endif
+// Use lockstep engine (see batch_sim.h) if all players are GREEDY
+#ifndef SIM_BATCH
+#define SIM_BATCH (1)
+#endif
+// Games stepped round-robin per worker (see game_stepper.h); only used if
+// no strategy keeps search state across games (MCTS). Off by
+// default: the distance tables of the default board fit into L2, such that
+// there is no latency for the prefetches to hide
+#ifndef SIM_INTERLEAVE
+#define SIM_INTERLEAVE (1)
+#endif
+
+// Options of simulation campaigns (see GameState_simulate)
+typedef struct {
+    uint64_t seed;               // game i is played from derive_seed(seed, i)
+    unsigned int nThreads;       // 0: number of cores
+    const char *ckpt_path;       // NULL: no checkpoints
+    unsigned long ckpt_interval; // games between checkpoints
+    bool resume;                 // continue from checkpoint (if valid)
+    MoveTiming_t *timing;        // NULL: moves are not timed
+} SimOptions_t;
+
+// Shared by all workers during one round
+typedef struct {
+    const BoardInfo_t *binfo;
+    const enum MOVE_STRATEGY *player_strategies;
+    AvoidParams_t player_params[MAX_PLAYERS];
+    unsigned int nPlayers;
+    uint64_t seed;
+    unsigned long first;    // index of first game of round
+    unsigned long nGames;   // games of round
+    unsigned int nBlocks;
+    atomic_uint next_block;
+    SimStats_t *blocks;
+    unsigned int nInterleave; // games in flight per worker
+    GameState_t *states;    // nInterleave games per worker
+    bool *states_valid;
+    bool batch;             // lockstep engine
+    MoveTiming_t *timings;  // one per worker (NULL: moves are not timed)
+    BatchResult_t *results; // SIM_BLOCK_GAMES per worker (NULL: scalar)
+} _SimRound;
+
+// Set up game (index within round) in slot of interleaved games
+static void _GameState_simulate_begin(const _SimRound *r, GameStepper_t *stepper,
+        GameState_t *gstate, unsigned long game)
+{
+    // Game only depends on its index
+    set_seed(derive_seed(r->seed, r->first + game));
+    GameState_reset(gstate, r->binfo->nPositions);
+    GameStepper_init(stepper, gstate, false);
+    GameStepper_prefetch(r->binfo, stepper, gstate);
+}
+
+// Play games [start, end) of round by stepping nInterleave games in turn,
+// prefetching the next move of each game while the others are stepped
+static void _GameState_simulate_interleaved(_SimRound *r, GameState_t *states,
+        unsigned long start, unsigned long end, BatchResult_t *results)
+{
+    GameStepper_t steppers[SIM_INTERLEAVE];
+    unsigned long games[SIM_INTERLEAVE];
+    bool live[SIM_INTERLEAVE];
+    unsigned int k, nLive = 0;
+    unsigned long next_game = start;
+    
+    for (k = 0; k < r->nInterleave; ++k) {
+        live[k] = next_game < end;
+        if (!live[k])
+            continue;
+        games[k] = next_game++;
+        _GameState_simulate_begin(r, &steppers[k], &states[k], games[k]);
+        ++nLive;
+    }
+    while (nLive > 0) {
+        for (k = 0; k < r->nInterleave; ++k) {
+            if (!live[k])
+                continue;
+            GameStepper_step(r->binfo, &steppers[k], &states[k],
+                    r->player_strategies, r->player_params, false);
+            if (!steppers[k].done) {
+                GameStepper_prefetch(r->binfo, &steppers[k], &states[k]);
+                continue;
+            }
+            // Store result & start next game in this slot
+            BatchResult_t *res = &results[games[k] - start];
+            res->result = GameStepper_result(&steppers[k]);
+            memcpy(res->player_order, states[k].player_order,
+                   r->nPlayers * sizeof(unsigned int));
+            if (next_game < end) {
+                games[k] = next_game++;
+                _GameState_simulate_begin(r, &steppers[k], &states[k], games[k]);
+            } else {
+                live[k] = false;
+                --nLive;
+            }
+        }
+    }
+}
+
+static void _GameState_simulate_worker(void *arg, unsigned int worker_id)
+{
+    _SimRound *r = (_SimRound *) arg;
+    GameState_t *states = &r->states[worker_id * r->nInterleave];
+    GameState_t *gstate = &states[0];
+    if (!r->states_valid[worker_id]) {
+        for (unsigned int k = 0; k < r->nInterleave; ++k)
+            GameState_init(&states[k], r->nPlayers, r->binfo->nPositions);
+        r->states_valid[worker_id] = true;
+    }
+    for (unsigned int k = 0; k < r->nInterleave; ++k)
+        states[k].timing = r->timings != NULL ? &r->timings[worker_id] : NULL;
+
+    unsigned int b;
+    while ((b = atomic_fetch_add(&r->next_block, 1)) < r->nBlocks) {
+        SimStats_init(&r->blocks[b], r->nPlayers);
+        const unsigned long start = (unsigned long)b * SIM_BLOCK_GAMES;
+        const unsigned long end = start + SIM_BLOCK_GAMES < r->nGames ?
+                start + SIM_BLOCK_GAMES : r->nGames;
+        if (r->results != NULL) {
+            // Accumulate in order of games, like the scalar loop below
+            BatchResult_t *results = &r->results[worker_id * SIM_BLOCK_GAMES];
+            if (r->batch)
+                BatchSim_run(r->binfo, gstate, r->seed, r->first + start,
+                             end - start, false, results);
+            else
+                _GameState_simulate_interleaved(r, states, start, end, results);
+            for (unsigned long i = 0; i < end - start; ++i) {
+                memcpy(gstate->player_order, results[i].player_order,
+                       r->nPlayers * sizeof(unsigned int));
+                SimStats_add(&r->blocks[b], &results[i].result, gstate);
+            }
+            continue;
+        }
+        for (unsigned long i = start; i < end; ++i) {
+            // Game only depends on its index
+            set_seed(derive_seed(r->seed, r->first + i));
+            GameState_reset(gstate, r->binfo->nPositions);
+            // Play until all placements are decided
+            Perf_begin(PERF_MOVES);
+            GameResult_t result = GameState_run(r->binfo, gstate,
+                    r->player_strategies, r->player_params, false, false);
+            Perf_end(PERF_MOVES);
+            Perf_begin(PERF_REDUCE);
+            SimStats_add(&r->blocks[b], &result, gstate);
+            Perf_end(PERF_REDUCE);
+        }
+    }
+}
+
+// Simulate nGames and accumulate statistics (turns, wins per seat & turn
+// order, placements and captures of individual players) into stats.
+// Results are bit-identical for any number of threads: every game draws
+// from its own stream, no strategy carries state from one move to the next
+// (EXPECTIMAX starts every search afresh, MCTS selects in fixed waves with
+// one stream per rollout, independent of its workers) and accumulators are
+// merged along a fixed tree. If a checkpoint path is given, a checkpoint
+// is written in the background (between rounds, every ckpt_interval games)
+// and at the end; with resume, the campaign continues from the checkpoint
+// (which must belong to the same strategies, seed, board and EXPECTIMAX
+// leaf, and may not hold more than nGames games) with identical results. MCTS
+// runs its own thread pool and is therefore simulated on one thread, as
+// are profiled runs (see perf_counters.h)
+int GameState_simulate(const BoardInfo_t *binfo, unsigned int nPlayers,
+        const enum MOVE_STRATEGY *player_strategies, unsigned long nGames,
+        const SimOptions_t *opts, SimStats_t *stats) {
     
     unsigned int i;
-    for (i = 0; i < gstate->nPlayers; ++i) {
+    unsigned int nThreads = opts->nThreads > 0 ? opts->nThreads :
+                                                 ThreadPool_num_cores();
+    BoardInfo_wait(binfo);
+    // Lockstep engine does not go through GameState_move (not timed)
+    bool batch = SIM_BATCH && opts->timing == NULL;
+    unsigned int nInterleave = SIM_INTERLEAVE;
+    if (Perf_enabled()) {
+        // Counters follow calling thread; profile games one at a time
+        nThreads = 1;
+        batch = false;
+        nInterleave = 1;
+    }
+    for (i = 0; i < nPlayers; ++i) {
+        batch = batch && player_strategies[i] == GREEDY;
         if (player_strategies[i] == USER_COMMAND) {
             return -1;  // invalid player strategy
         }
+        if (player_strategies[i] == MCTS) {
+            nInterleave = 1;  // search state depends on previous moves
+            nThreads = 1;
+        }
     }
     
-    unsigned int *wins = (unsigned int *) calloc(gstate->nPlayers, sizeof(unsigned int));
-    assert(wins != NULL);
-    
-    unsigned int nUndecided = 0;
-    unsigned int max_turns = 0;
-    unsigned int min_turns = MAX_TURNS + 1;
-    double avg_turns = 0.;
+    _SimRound r;
+    r.binfo = binfo;
+    r.player_strategies = player_strategies;
+    r.nPlayers = nPlayers;
+    r.seed = opts->seed;
+    r.batch = batch;
+    r.nInterleave = batch || nInterleave < 1 ? 1 : nInterleave;
+    // All players use default parameters
+    for (i = 0; i < nPlayers; ++i) {
+        r.player_params[i] = AVOID_PARAMS_DEFAULT;
+    }
+    SimStats_init(stats, nPlayers);
     
-    for (i = 0; i < nGames; ++i) {
-        GameResult_t result = GameState_run(binfo, gstate, player_strategies, true, false);
-        // Update wins
-        if (result.winner != -1) {
-            ++wins[result.winner];
-        } else {
-            ++nUndecided;
+    unsigned long done = 0;
+    Checkpoint_t ckpt;
+    if (opts->resume && opts->ckpt_path != NULL &&
+            Checkpoint_load(&ckpt, opts->ckpt_path)) {
+        if (!Checkpoint_matches(&ckpt, nPlayers, player_strategies)) {
+            fprintf(stderr, "Checkpoint '%s' belongs to different strategies\n",
+                    opts->ckpt_path);
+            return -1;
         }
-        
-        // Update turn number statistics
-        if (result.nTurns < min_turns) {
-            min_turns = result.nTurns;
+        if (ckpt.seed != opts->seed) {
+            fprintf(stderr, "Checkpoint '%s' was written with seed %lu, not %lu\n",
+                    opts->ckpt_path, (unsigned long) ckpt.seed,
+                    (unsigned long) opts->seed);
+            return -1;
+        }
+        if (ckpt.board_hash != Checkpoint_board_hash(binfo)) {
+            fprintf(stderr, "Checkpoint '%s' was written on board '%s', not '%s'\n",
+                    opts->ckpt_path, ckpt.board_dir, binfo->board_dir);
+            return -1;
         }
-        if (result.nTurns > max_turns) {
-            max_turns = result.nTurns;
+        const bool endgame_leaf = Expectimax_endgame_leaf(binfo);
+        if (ckpt.endgame_leaf != endgame_leaf) {
+            fprintf(stderr, "Checkpoint '%s' was written %s the endgame leaf "
+                    "of EXPECTIMAX, which is %s now\n", opts->ckpt_path,
+                    ckpt.endgame_leaf ? "with" : "without",
+                    endgame_leaf ? "used" : "not used");
+            return -1;
         }
-        avg_turns += result.nTurns;
-        // Reset game state and randomize for next game
-        GameState_reset(gstate, binfo->nPositions);
+        if (ckpt.nGames > nGames) {
+            fprintf(stderr, "Checkpoint '%s' already holds %lu games, more than "
+                    "the %lu requested\n", opts->ckpt_path,
+                    (unsigned long) ckpt.nGames, nGames);
+            return -1;
+        }
+        memcpy(stats, &ckpt.stats, sizeof(SimStats_t));
+        done = ckpt.nGames;
+        printf("Resuming from checkpoint after %lu games\n", done);
+    } else if (opts->resume && opts->ckpt_path != NULL) {
+        printf("No valid checkpoint '%s', starting from scratch\n",
+               opts->ckpt_path);
     }
-    avg_turns /= (double)nGames;
     
-    printf("Total games played: %u\n", nGames);
-    printf("Of which %u were undecided.\n", nUndecided);
-    printf("\nStatistics:\n");
-    for (i = 0; i < gstate->nPlayers; ++i) {
-        printf("%sPlayer: %u\tWins: %u (%.2f%%)\tStrategy: %s%s\n", 
-            PLAYER_COLORS[i], i+1, wins[i], (double)wins[i] / nGames * 100.,
-                STRATEGY_NAMES[player_strategies[i]], DEFAULT_COLOR);
+    CheckpointWriter writer;
+    if (opts->ckpt_path != NULL)
+        CheckpointWriter_init(&writer, opts->ckpt_path);
+    ThreadPool pool;
+    if (nThreads > 1)
+        ThreadPool_init(&pool, nThreads);
+    r.blocks = (SimStats_t *) malloc(SIM_ROUND_BLOCKS * sizeof(SimStats_t));
+    assert(r.blocks != NULL);
+    r.states = (GameState_t *) malloc(nThreads * r.nInterleave *
+                                      sizeof(GameState_t));
+    assert(r.states != NULL);
+    r.states_valid = (bool *) calloc(nThreads, sizeof(bool));
+    assert(r.states_valid != NULL);
+    r.timings = NULL;
+    if (opts->timing != NULL) {
+        r.timings = (MoveTiming_t *) malloc(nThreads * sizeof(MoveTiming_t));
+        assert(r.timings != NULL);
+        for (i = 0; i < nThreads; ++i)
+            MoveTiming_init(&r.timings[i]);
+    }
+    r.results = NULL;
+    if (batch || r.nInterleave > 1) {
+        r.results = (BatchResult_t *) malloc(nThreads * SIM_BLOCK_GAMES *
+                                             sizeof(BatchResult_t));
+        assert(r.results != NULL);
+    }
+    
+    // Round boundaries only depend on game indices
+    const unsigned long round_games = (unsigned long)SIM_BLOCK_GAMES * SIM_ROUND_BLOCKS;
+    unsigned long last_ckpt = done;
+    while (done < nGames) {
+        r.first = done;
+        r.nGames = nGames - done < round_games ? nGames - done : round_games;
+        r.nBlocks = (r.nGames + SIM_BLOCK_GAMES - 1) / SIM_BLOCK_GAMES;
+        atomic_init(&r.next_block, 0);
+        const uint64_t span = Trace_begin();
+        if (nThreads > 1)
+            ThreadPool_run(&pool, _GameState_simulate_worker, &r);
+        else
+            _GameState_simulate_worker(&r, 0);
+        Perf_begin(PERF_REDUCE);
+        SimStats_reduce(r.blocks, r.nBlocks);
+        SimStats_merge(stats, &r.blocks[0]);
+        Perf_end(PERF_REDUCE);
+        Trace_end("simulate round", span);
+        done += r.nGames;
+        
+        if (opts->ckpt_path != NULL && opts->ckpt_interval > 0 &&
+                done - last_ckpt >= opts->ckpt_interval && done < nGames) {
+            Checkpoint_init(&ckpt, binfo, stats, player_strategies, done, r.seed);
+            CheckpointWriter_submit(&writer, &ckpt);
+            last_ckpt = done;
+        }
+    }
+    if (opts->ckpt_path != NULL) {
+        Checkpoint_init(&ckpt, binfo, stats, player_strategies, done, r.seed);
+        CheckpointWriter_submit(&writer, &ckpt);
+        CheckpointWriter_free(&writer);
     }
-    printf("Max. turns: %u\n", max_turns);
-    printf("Min. turns: %u\n", min_turns);
-    printf("Avg. turns: %.2f\n", avg_turns);
-    // Cleanup
-    free(wins);
     
+    // Histograms of all workers
+    if (opts->timing != NULL) {
+        MoveTiming_init(opts->timing);
+        for (i = 0; i < nThreads; ++i)
+            MoveTiming_merge(opts->timing, &r.timings[i]);
+    }
+    
+    // Cleanup
+    if (nThreads > 1)
+        ThreadPool_free(&pool);
+    for (i = 0; i < nThreads; ++i) {
+        if (!r.states_valid[i])
+            continue;
+        for (unsigned int k = 0; k < r.nInterleave; ++k)
+            GameState_free(&r.states[i * r.nInterleave + k]);
+    }
+    free(r.states);
+    free(r.states_valid);
+    free(r.blocks);
+    free(r.results);
+    free(r.timings);
+    return 0;  // ok
+}
+
+// Compute & print statistics of nGames using all cores (master seed drawn
+// from stream of calling thread)
+int GameState_statistics(const BoardInfo_t *binfo, GameState_t *gstate, 
+        const enum MOVE_STRATEGY *player_strategies, unsigned int nGames) {
+    SimOptions_t opts = {.seed = next(), .nThreads = 0, .ckpt_path = NULL,
+                         .ckpt_interval = 0, .resume = false, .timing = NULL};
+    SimStats_t stats;
+    if (GameState_simulate(binfo, gstate->nPlayers, player_strategies,
+                           nGames, &opts, &stats) != 0) {
+        return -1;
+    }
+    SimStats_print(&stats, player_strategies);
     return 0;  // ok
 }
 
@@ -0,0 +1,170 @@
+/*
+ * Resumable turn progression of one game (state machine).
+ *
+ * - GameStepper_step makes a single move of the player to move (one call
+ *   of GameState_move) and returns; the stepper remembers whose turn it
+ *   is, so callers can suspend a game after every move and resume it later
+ * - Capturing the Boeg (AGAIN) keeps the turn with the same player
+ * - Bookkeeping (captures, ranking, winner, MAX_TURNS) is done by
+ *   GameStepper_record, which can also be fed with moves made elsewhere
+ *   (e.g. clicks of a user in the GUI)
+ * - GameStepper_prefetch touches the distance rows of the next move, such
+ *   that a worker stepping several games round-robin overlaps their loads
+ *   with the moves of the other games
+ * - Builds with -DFANG_CHECK_HASH verify the incremental hash against
+ *   GameState_hash after every move (recomputed from scratch; slow); the
+ *   throughput tool checks the first games of every case by default
+ *
+ * Must be included from game_state.h (needs GameState_move & GameResult_t)
+ */
+
+#pragma once
+#ifndef GAME_STEPPER_H
+#define GAME_STEPPER_H
+
+#ifndef GAME_STATE_H
+#error "game_stepper.h needs to be included from game_state.h."
+#endif
+
+typedef struct {
+    unsigned int turn;       // index into player order of player to move
+    unsigned int nTurns;     // current round
+    unsigned int boeg_id;    // Boeg at beginning of current turn
+    int winner;
+    unsigned int winTurn;
+    unsigned int ranking[MAX_PLAYERS];
+    unsigned int nFinished;  // how many players have finished
+    unsigned int captures[MAX_PLAYERS];
+    unsigned int nMoves;
+    bool midTurn;            // player moves again after capturing the Boeg
+    bool stop_at_first;      // game is over once the winner is known
+    bool done;
+} GameStepper_t;
+
+// Pass turn on to next active player (counting rounds)
+static void _GameStepper_advance(GameStepper_t *s, const GameState_t *gstate)
+{
+    do {
+        if (++s->turn == gstate->nPlayers) {
+            s->turn = 0;
+            if (++s->nTurns == MAX_TURNS) {
+                s->done = true;
+                return;
+            }
+        }
+    } while (!is_active_player(gstate, gstate->player_order[s->turn]));
+    s->boeg_id = gstate->boeg_id;
+}
+
+// Begin game of (freshly reset) game state
+void GameStepper_init(GameStepper_t *s, const GameState_t *gstate,
+                      bool stop_at_first)
+{
+    memset(s, 0, sizeof(GameStepper_t));
+    s->winner = -1;
+    s->nTurns = 1;
+    s->stop_at_first = stop_at_first;
+    s->boeg_id = gstate->boeg_id;
+    if (!is_active_player(gstate, gstate->player_order[0]))
+        _GameStepper_advance(s, gstate);
+}
+
+// Id of player to move (only valid while game is not done)
+static inline unsigned int GameStepper_player(const GameStepper_t *s,
+                                              const GameState_t *gstate)
+{
+    return gstate->player_order[s->turn];
+}
+
+// Account for move made by player to move (status of its move)
+static inline void GameStepper_record(GameStepper_t *s, GameState_t *gstate,
+                                      enum STATUS status)
+{
+    assert(!s->done && status != INVALID);
+    ++s->nMoves;
+    s->midTurn = status == AGAIN;
+    if (s->midTurn)
+        return;  // same player moves again
+
+    const unsigned int player_id = GameStepper_player(s, gstate);
+    // Count captures of Boeg
+    if (s->boeg_id != player_id && gstate->boeg_id == player_id) {
+        ++s->captures[player_id];
+    }
+    // Check if game is over
+    if (status == GAMEOVER) {
+        if (s->nFinished == 0) {
+            // First player to reach game over is winner
+            s->winner = player_id;
+            s->winTurn = s->nTurns;
+            // Check if overall game should be over
+            if (s->stop_at_first) {
+                s->ranking[s->nFinished++] = player_id;
+                s->done = true;
+                return;
+            }
+        }
+        // Reset boeg ID to default
+        assert(player_id == gstate->boeg_id);
+        GameState_set_boeg_id(gstate, BOEG_ID_DEFAULT);
+        // Update ranking of players
+        s->ranking[s->nFinished++] = player_id;
+
+        if (s->nFinished == gstate->nPlayers - 1) {
+            // Determine last place
+            for (unsigned int j = 0; j < gstate->nPlayers; ++j) {
+                if (is_active_player(gstate, j)) {
+                    s->ranking[s->nFinished++] = j;
+                    break;  // found
+                }
+            }
+            // Game is decided
+            s->done = true;
+            return;
+        }
+    }
+    _GameStepper_advance(s, gstate);
+}
+
+// Make next move of game (player to move uses its strategy)
+static inline enum STATUS GameStepper_step(const BoardInfo_t *binfo,
+        GameStepper_t *s, GameState_t *gstate,
+        const enum MOVE_STRATEGY *player_strategies,
+        const AvoidParams_t *player_params, bool verbose)
+{
+    const unsigned int player_id = GameStepper_player(s, gstate);
+    const enum STATUS status = GameState_move(binfo, gstate, player_id,
+            &player_params[player_id], player_strategies[player_id], verbose);
+#ifdef FANG_CHECK_HASH
+    // Incremental hash must match hash computed from scratch
+    assert(gstate->hash == GameState_hash(gstate));
+#endif
+    GameStepper_record(s, gstate, status);
+    return status;
+}
+
+// Request distance rows read by next move into cache
+static inline void GameStepper_prefetch(const BoardInfo_t *binfo,
+        const GameStepper_t *s, const GameState_t *gstate)
+{
+    const unsigned int n = binfo->nPositions;
+    const unsigned int player_pos = gstate->player_pos[GameStepper_player(s, gstate)];
+    const int *row_player = &binfo->dist_player[player_pos * n];
+    const int *row_boeg = &binfo->dist_boeg[gstate->boeg_pos * n];
+    for (unsigned int i = 0; i < n; i += 64 / sizeof(int)) {
+        __builtin_prefetch(&row_player[i]);
+        __builtin_prefetch(&row_boeg[i]);
+    }
+}
+
+GameResult_t GameStepper_result(const GameStepper_t *s)
+{
+    GameResult_t result = {.winner=s->winner, .nTurns=s->nTurns,
+                           .winTurn=s->winTurn, .nRanked=s->nFinished,
+                           .nMoves=s->nMoves};
+    memcpy(result.ranking, s->ranking, sizeof(s->ranking));
+    memcpy(result.captures, s->captures, sizeof(s->captures));
+    return result;
+}
+
+#endif /* GAME_STEPPER_H */
@@ -7,9 +7,103 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <assert.h>
 
 #define MAX_INFO 512
 
+// State cache of the (single) GL context
+// - Bindings go through the bind*Cached/useProgramCached functions, which
+//   skip the driver call if the object is bound already; direct binds of
+//   the same targets would desynchronize the cache
+// - Uniform locations are resolved once after linking into typed handles,
+//   which remember their program (must be in use when setting them)
+typedef struct {
+    GLuint program;
+    GLuint vao;
+    GLuint arrayBuffer;
+    GLuint texture2D;  // of texture unit 0 (the only one used)
+} GLStateCache;
+
+static GLStateCache _glState = {0, 0, 0, 0};
+
+typedef struct { GLuint program; GLint loc; } GLUniformBool;
+typedef struct { GLuint program; GLint loc; } GLUniformVec3;
+typedef struct { GLuint program; GLint loc; } GLUniformMat4;
+
+static inline void useProgramCached(GLuint program)
+{
+    if (_glState.program != program) {
+        glUseProgram(program);
+        _glState.program = program;
+    }
+}
+
+static inline void bindVertexArrayCached(GLuint vao)
+{
+    if (_glState.vao != vao) {
+        glBindVertexArray(vao);
+        _glState.vao = vao;
+    }
+}
+
+static inline void bindArrayBufferCached(GLuint buffer)
+{
+    if (_glState.arrayBuffer != buffer) {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        _glState.arrayBuffer = buffer;
+    }
+}
+
+static inline void bindTexture2DCached(GLuint texture)
+{
+    if (_glState.texture2D != texture) {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        _glState.texture2D = texture;
+    }
+}
+
+// Location of uniform (-1, i.e. setting it is a no-op, if unused by program)
+static GLint _getUniformLocation(GLuint program, const GLchar *name)
+{
+    GLint loc = glGetUniformLocation(program, name);
+    if (loc == -1)
+        fprintf(stderr, "Uniform '%s' not active in program %u\n", name, program);
+    return loc;
+}
+
+GLUniformBool getUniformBool(GLuint program, const GLchar *name)
+{
+    return (GLUniformBool) {program, _getUniformLocation(program, name)};
+}
+
+GLUniformVec3 getUniformVec3(GLuint program, const GLchar *name)
+{
+    return (GLUniformVec3) {program, _getUniformLocation(program, name)};
+}
+
+GLUniformMat4 getUniformMat4(GLuint program, const GLchar *name)
+{
+    return (GLUniformMat4) {program, _getUniformLocation(program, name)};
+}
+
+static inline void setUniformBool(GLUniformBool u, GLboolean value)
+{
+    assert(_glState.program == u.program);
+    glUniform1i(u.loc, value);
+}
+
+static inline void setUniformVec3(GLUniformVec3 u, const GLfloat *value)
+{
+    assert(_glState.program == u.program);
+    glUniform3fv(u.loc, 1, value);
+}
+
+static inline void setUniformMat4(GLUniformMat4 u, const GLfloat *value)
+{
+    assert(_glState.program == u.program);
+    glUniformMatrix4fv(u.loc, 1, GL_FALSE, value);
+}
+
 GLuint createGLShader(GLenum shaderType, const GLchar *shaderSource) {
     // Create shader
     GLuint shader = glCreateShader(shaderType);
@@ -103,9 +103,18 @@ void Graph_init_file(Graph *graph, FILE *fp)
     unsigned int from_node;
     unsigned int to_node;
     unsigned int boeg;
-    // Initialize graph by parsing file
-    while ((fscanf(fp, "%u %u %u", &from_node, &to_node, &boeg)) != EOF) {
-        if (from_node >= nVertices || to_node >= nVertices) {
+    char line[256];
+    // Initialize graph by parsing file line by line (Boeg column is optional,
+    // e.g. graph_player.txt & the fixtures in graphs/ only list edges of players)
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        const int nRead = sscanf(line, "%u %u %u", &from_node, &to_node, &boeg);
+        if (nRead <= 0) {
+            continue;  // blank line
+        }
+        if (nRead == 2) {
+            boeg = 0;
+        }
+        if (nRead == 1 || from_node >= nVertices || to_node >= nVertices) {
             fprintf(stderr, "Invalid edge at line: %u\n", graph->nEdge + 1);
             Graph_free(graph);
             fclose(fp);
@@ -28,20 +28,17 @@
 #define BSIZE_VERT_POS (2*(N_TRIANGLES_CIRCLE + 2))
 #define RAD_CIRCLE 0.03f
 #define EDGE_WIDTH 3.0f
-#define INSTANCE_LENGTH 64
 #define DELAY_MS 1000
 
 // Source of vertex shader in glsl
-#define VERT_SHADER_LENGTH 1024
-static GLchar _boardVertShaderSource[VERT_SHADER_LENGTH];
-
-static const GLchar *_boardVertShaderTemplate = R"glsl(
+// - Edges: color per vertex
+// - Nodes: color & offset per instance (attribute divisor 1)
+static const GLchar *_boardVertShaderSource = R"glsl(
 #version 460 core
 layout(location = 0) in vec2 aPos;
 layout(location = 1) in vec3 aColor;
 layout(location = 2) in vec2 aOffset;
 uniform bool isInstanced;
-uniform vec3 circInstanceColors[%d];
 out vec3 vertexColor;
 void main() {
     vec2 finalPos = aPos;
@@ -49,12 +46,7 @@ void main() {
         finalPos = finalPos + aOffset;
     }
     gl_Position = vec4(finalPos, 0.0, 1.0);
-    
-    if (isInstanced) {
-        vertexColor = circInstanceColors[gl_InstanceID];
-    } else {
-        vertexColor = aColor;
-    }
+    vertexColor = aColor;
 }
 )glsl";
 
@@ -75,7 +67,13 @@ typedef struct {
 
 // GLOBALS
 static GLuint _boardShaderProgram;
-static GLuint _vboNodeCirc, _vboNodeOffsets, _vaoNode;
+static GLUniformBool _boardIsInstanced;
+static GLuint _vboNodeCirc, _vboNodeOffsets, _vboNodeCols, _vaoNode;
+// Colors of nodes (CPU copy of _vboNodeCols); nodes dirtyBegin..dirtyEnd-1
+// changed since last upload
+static vec3 *_nodeCols = NULL;
+static GLuint _nNodeCols = 0;
+static GLuint _nodeColsDirtyBegin = 0, _nodeColsDirtyEnd = 0;
 static GLuint _vboEdge, _vaoEdge;
 
 static SearchMap _sm;
@@ -109,24 +107,34 @@ static const vec3 COLORS[] = {
 // OpenGL helpers
 void setIsInstanced(GLboolean flag)
 {    
-    // Get location for isInstanced from shader program
-    GLint isInstancedLoc = glGetUniformLocation(_boardShaderProgram, "isInstanced");
     // Set isInstanced in vertex shader to 'flag'
-    glUniform1i(isInstancedLoc, flag);
+    setUniformBool(_boardIsInstanced, flag);
 }
 
+// Set color of node i (uploaded with next uploadNodeCols)
 void setColor(const vec3 rgb, GLuint i)
 {
-    glUseProgram(_boardShaderProgram);
-    
-    char stringLoc[INSTANCE_LENGTH];
-    snprintf(stringLoc, INSTANCE_LENGTH, "circInstanceColors[%u]", i);
-    // Get location from shader program
-    GLint circColorLoc = glGetUniformLocation(_boardShaderProgram, stringLoc);
-    // Set location to color value
-    glUniform3f(circColorLoc, rgb[0], rgb[1], rgb[2]);
-    
-    glUseProgram(0);
+    assert(i < _nNodeCols);
+    glm_vec3_copy((GLfloat *)rgb, _nodeCols[i]);
+    if (_nodeColsDirtyBegin == _nodeColsDirtyEnd) {
+        _nodeColsDirtyBegin = i;
+        _nodeColsDirtyEnd = i + 1;
+    } else {
+        _nodeColsDirtyBegin = i < _nodeColsDirtyBegin ? i : _nodeColsDirtyBegin;
+        _nodeColsDirtyEnd = i + 1 > _nodeColsDirtyEnd ? i + 1 : _nodeColsDirtyEnd;
+    }
+}
+
+// Upload changed colors of nodes (single glBufferSubData)
+void uploadNodeCols()
+{
+    if (_nodeColsDirtyBegin == _nodeColsDirtyEnd)
+        return;
+    bindArrayBufferCached(_vboNodeCols);
+    glBufferSubData(GL_ARRAY_BUFFER, _nodeColsDirtyBegin*sizeof(vec3),
+                    (_nodeColsDirtyEnd - _nodeColsDirtyBegin)*sizeof(vec3),
+                    _nodeCols[_nodeColsDirtyBegin]);
+    _nodeColsDirtyBegin = _nodeColsDirtyEnd = 0;
 }
 
 void initNodeCols(GLuint nNodes)
@@ -224,6 +232,7 @@ void populateSearchMap(const GameState_t *gstate)
 void initBoardGL(int *argc, char *argv[], const char *fontPath, 
                  const BoardInfo_t *binfo)
 {
+    const uint64_t span = Trace_begin();
     // Initialize GL context
 	glutInit(argc, argv);
     // Get screen resolution
@@ -255,14 +264,13 @@ void initBoardGL(int *argc, char *argv[], const char *fontPath,
     // Initialize font
     fontInit(fontPath);
     
-    // Set number of instances in vertex shader
-    snprintf(_boardVertShaderSource, VERT_SHADER_LENGTH,
-             _boardVertShaderTemplate, binfo->nPositions);
     // Create shader program
     _boardShaderProgram = createGLProgram(_boardVertShaderSource, 
                                           _boardFragShaderSource);
+    _boardIsInstanced = getUniformBool(_boardShaderProgram, "isInstanced");
     // Finally, use shader program
-    glUseProgram(_boardShaderProgram);
+    useProgramCached(_boardShaderProgram);
+    glLineWidth(EDGE_WIDTH);
     
     // Prepare node properties for drawing
     {
@@ -270,23 +278,26 @@ void initBoardGL(int *argc, char *argv[], const char *fontPath,
         GLfloat vertexPos[BSIZE_VERT_POS];
         initVertexPosNodes(vertexPos);
         // Initialize colors for nodes
+        _nNodeCols = binfo->nPositions;
+        _nodeCols = (vec3 *) malloc(_nNodeCols*sizeof(vec3));
+        assert(_nodeCols != NULL);
         initNodeCols(binfo->nPositions);
         
         glGenVertexArrays(1, &_vaoNode);
-        glBindVertexArray(_vaoNode);
+        bindVertexArrayCached(_vaoNode);
         
         // Positions on circle perimeter (shared)
         glGenBuffers(1, &_vboNodeCirc);
-        glBindBuffer(GL_ARRAY_BUFFER, _vboNodeCirc);
+        bindArrayBufferCached(_vboNodeCirc);
         glBufferData(GL_ARRAY_BUFFER, BSIZE_VERT_POS*sizeof(GLfloat), 
                      vertexPos, GL_STATIC_DRAW);
         glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, NULL);
         glEnableVertexAttribArray(0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);  // unbind
+        bindArrayBufferCached(0);  // unbind
         
         // Node offsets
         glGenBuffers(1, &_vboNodeOffsets);
-        glBindBuffer(GL_ARRAY_BUFFER, _vboNodeOffsets);
+        bindArrayBufferCached(_vboNodeOffsets);
         glBufferData(GL_ARRAY_BUFFER, binfo->nPositions*sizeof(Location_t),
                     binfo->locations, GL_STATIC_DRAW);
         glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Location_t),
@@ -294,9 +305,19 @@ void initBoardGL(int *argc, char *argv[], const char *fontPath,
         glEnableVertexAttribArray(2);
         // Set vertex attribute divisor for instanced rendering
         glVertexAttribDivisor(2, 1);
+        
+        // Node colors (updated in place, see uploadNodeCols)
+        glGenBuffers(1, &_vboNodeCols);
+        bindArrayBufferCached(_vboNodeCols);
+        glBufferData(GL_ARRAY_BUFFER, _nNodeCols*sizeof(vec3), _nodeCols,
+                     GL_DYNAMIC_DRAW);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), NULL);
+        glEnableVertexAttribArray(1);
+        glVertexAttribDivisor(1, 1);
+        _nodeColsDirtyBegin = _nodeColsDirtyEnd = 0;  // just uploaded
         // unbind
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
+        bindArrayBufferCached(0);
+        bindVertexArrayCached(0);
     }
     // DONE nodes
     
@@ -311,11 +332,11 @@ void initBoardGL(int *argc, char *argv[], const char *fontPath,
         initEdges(edgeBuf, binfo);
         
         glGenVertexArrays(1, &_vaoEdge);
-        glBindVertexArray(_vaoEdge);
+        bindVertexArrayCached(_vaoEdge);
         
         // Edge positions
         glGenBuffers(1, &_vboEdge);
-        glBindBuffer(GL_ARRAY_BUFFER, _vboEdge);
+        bindArrayBufferCached(_vboEdge);
         glBufferData(GL_ARRAY_BUFFER, bufSize, edgeBuf, GL_STATIC_DRAW);
         glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
                               (void *)offsetof(Vertex, pos));
@@ -326,32 +347,31 @@ void initBoardGL(int *argc, char *argv[], const char *fontPath,
                               (void *)offsetof(Vertex, col));
         glEnableVertexAttribArray(1);
         // unbind
-        glBindBuffer(GL_ARRAY_BUFFER, 0);  // unbind
-        glBindVertexArray(0);
+        bindArrayBufferCached(0);  // unbind
+        bindVertexArrayCached(0);
         // Clean-up
         free(edgeBuf);
     }
     // DONE edges
-    glUseProgram(0);
+    useProgramCached(0);
+    Trace_end("initBoardGL", span);
 }
 
 void renderBoard(GLuint nNodes, GLuint nEdges)
 {
-    glUseProgram(_boardShaderProgram);
+    // Colors changed since last frame
+    uploadNodeCols();
+    // Bindings are kept for the next frame (see gl_common.h)
+    useProgramCached(_boardShaderProgram);
     // Last argument specifies total number of vertices. Three consecutive
     // vertices are drawn as one triangle
-    glBindVertexArray(_vaoNode);
+    bindVertexArrayCached(_vaoNode);
     setIsInstanced(GL_TRUE);  // set to true
     // NOTE: GL_TRIANGLE_FAN draws N - 2 triangles -> first point
     //       (after center) must be included at the end as well
     glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, N_TRIANGLES_CIRCLE + 2, nNodes);
-    glBindVertexArray(0);
     
-    glBindVertexArray(_vaoEdge);
-    glLineWidth(EDGE_WIDTH);
+    bindVertexArrayCached(_vaoEdge);
     setIsInstanced(GL_FALSE);  // set to false
     glDrawArrays(GL_LINES, 0, 6*nEdges);
-    glBindVertexArray(0);
-    
-    glUseProgram(0);
 }
@@ -0,0 +1,384 @@
+/*
+ * Monte Carlo tree search strategy with parallel rollouts.
+ *
+ * - Root of the search is the decision after rolling the dice; every
+ *   legal destination is one child, selected using UCB1
+ * - Every rollout applies the selected move to a copy of the game and
+ *   plays it out (all players using a cheap rollout strategy) until the
+ *   first player finishes or MCTS_ROLLOUT_TURNS rounds have passed
+ * - A rollout is won if the searching player finishes first
+ * - Rollouts run in waves of MCTS_WAVE: the calling thread selects the
+ *   children of all rollouts of a wave up front, the workers of a thread
+ *   pool play them out (each on its own copy of the game state), and the
+ *   wins are counted once the wave is done
+ * - Virtual loss: the visit of a child is counted as soon as it is
+ *   selected (its win only once its wave is done), which spreads the
+ *   rollouts of a wave over the children
+ * - The dice of rollout i are drawn from derive_seed(seed of search, i),
+ *   such that the chosen move only depends on the game (not on the number
+ *   of workers or their scheduling)
+ * - The most visited child is played
+ * - Configuration, worker threads and their copies of the game belong to
+ *   the board context (started by the first search, one search at a time);
+ *   children & waves of a search to the thread context of the game state
+ *
+ * Must be included from game_state.h (needs BoardInfo_t & GameState_t)
+ */
+
+#pragma once
+#ifndef MCTS_H
+#define MCTS_H
+
+#ifndef GAME_STATE_H
+#error "mcts.h needs to be included from game_state.h."
+#endif
+
+#include <math.h>  // sqrt, log
+#include <stdatomic.h>
+
+#include "thread_pool.h"
+
+// Number of rollouts per move
+#ifndef MCTS_ROLLOUTS
+#define MCTS_ROLLOUTS (2000)
+#endif
+// Maximum number of rounds played per rollout
+#ifndef MCTS_ROLLOUT_TURNS
+#define MCTS_ROLLOUT_TURNS (MAX_TURNS)
+#endif
+// Exploration constant of UCB1
+#ifndef MCTS_EXPLORATION
+#define MCTS_EXPLORATION (1.0)
+#endif
+// Number of rollouts selected at once (independent of number of workers)
+#ifndef MCTS_WAVE
+#define MCTS_WAVE (64)
+#endif
+
+typedef struct {
+    unsigned int pos;
+    unsigned long visits;  // includes rollouts of current wave
+    unsigned long wins;
+} _MCTSChild;
+
+// Board context: configuration, worker threads & their copies of the game
+typedef struct {
+    // Configuration
+    unsigned long rollouts;
+    unsigned int nThreads;
+    enum MOVE_STRATEGY rollout_strat;
+    // Lazily initialized resources (by first search)
+    pthread_mutex_t lock;     // held during search
+    bool initialized;
+    ThreadPool pool;
+    GameState_t *states;      // one copy of game per worker
+    bool *states_valid;
+} _MCTSBoard;
+
+// Thread context: buffers of search
+typedef struct {
+    unsigned int *wave_child; // MCTS_WAVE entries
+    bool *wave_won;
+    _MCTSChild *children;
+    unsigned int capacity;    // maximum number of children
+} _MCTSThread;
+
+// Shared by all workers during one search
+typedef struct {
+    const BoardInfo_t *binfo;
+    _MCTSBoard *board;
+    const GameState_t *root;
+    unsigned int player_id;
+    int dice_roll;
+    const AvoidParams_t *params;
+    _MCTSChild *children;
+    unsigned int nChildren;
+    unsigned long total_visits;
+    uint64_t seed;               // of search (see _MCTS_rollout)
+    // Current wave
+    unsigned long wave_first;    // index of first rollout
+    unsigned int wave_size;
+    atomic_uint next_rollout;    // next rollout of wave to be claimed
+    unsigned int *wave_child;    // selected child per rollout
+    bool *wave_won;              // result per rollout
+} _MCTSSearch;
+
+static void *_MCTS_board_init(const BoardInfo_t *binfo)
+{
+    (void) binfo;
+    _MCTSBoard *board = (_MCTSBoard *) malloc(sizeof(_MCTSBoard));
+    assert(board != NULL);
+    board->rollouts = MCTS_ROLLOUTS;
+    board->nThreads = 0;  // number of cores
+    board->rollout_strat = GREEDY;
+    pthread_mutex_init(&board->lock, NULL);
+    board->initialized = false;
+    return board;
+}
+
+// Release worker threads and their games
+static void _MCTS_board_free(void *ctx)
+{
+    _MCTSBoard *board = (_MCTSBoard *) ctx;
+    if (board->initialized) {
+        ThreadPool_free(&board->pool);
+        for (unsigned int i = 0; i < board->nThreads; ++i) {
+            if (board->states_valid[i])
+                GameState_free(&board->states[i]);
+        }
+        free(board->states);
+        free(board->states_valid);
+    }
+    pthread_mutex_destroy(&board->lock);
+    free(board);
+}
+
+// Set number of rollouts per move, number of worker threads (0: number of
+// cores) and the strategy used by all players during rollouts on board.
+// Must be called before the first move using MCTS
+void MCTS_configure(BoardInfo_t *binfo, unsigned long rollouts,
+                    unsigned int nThreads, enum MOVE_STRATEGY rollout_strat)
+{
+    BoardInfo_wait(binfo);  // contexts are built in the background
+    _MCTSBoard *board = (_MCTSBoard *) binfo->strategy_board[MCTS];
+    assert(!board->initialized);
+    assert(rollouts > 0);
+    if (rollout_strat >= USER_COMMAND || rollout_strat == MCTS) {
+        fprintf(stderr, "Rollout strategy must not be MCTS (e.g. GREEDY or AVOIDANT)\n");
+        exit(EXIT_FAILURE);
+    }
+    board->rollouts = rollouts;
+    board->nThreads = nThreads;
+    board->rollout_strat = rollout_strat;
+}
+
+// Start worker threads (board lock held)
+static void _MCTS_board_start(_MCTSBoard *board)
+{
+    if (board->nThreads == 0)
+        board->nThreads = ThreadPool_num_cores();
+    ThreadPool_init(&board->pool, board->nThreads);
+    board->states = (GameState_t *) malloc(board->nThreads * sizeof(GameState_t));
+    assert(board->states != NULL);
+    board->states_valid = (bool *) calloc(board->nThreads, sizeof(bool));
+    assert(board->states_valid != NULL);
+    board->initialized = true;
+}
+
+static void *_MCTS_thread_init(const BoardInfo_t *binfo, const void *board_ctx)
+{
+    (void) board_ctx;
+    _MCTSThread *ctx = (_MCTSThread *) malloc(sizeof(_MCTSThread));
+    assert(ctx != NULL);
+    ctx->wave_child = (unsigned int *) malloc(MCTS_WAVE * sizeof(unsigned int));
+    assert(ctx->wave_child != NULL);
+    ctx->wave_won = (bool *) malloc(MCTS_WAVE * sizeof(bool));
+    assert(ctx->wave_won != NULL);
+    // Legal moves of Boeg include reachable targets on top of positions
+    ctx->capacity = binfo->nPositions + N_TARGETS_PLAYER;
+    ctx->children = (_MCTSChild *) malloc(ctx->capacity * sizeof(_MCTSChild));
+    assert(ctx->children != NULL);
+    return ctx;
+}
+
+static void _MCTS_thread_free(void *thread_ctx)
+{
+    _MCTSThread *ctx = (_MCTSThread *) thread_ctx;
+    free(ctx->wave_child);
+    free(ctx->wave_won);
+    free(ctx->children);
+    free(ctx);
+}
+
+// Select child with highest upper confidence bound
+static unsigned int _MCTS_select(_MCTSSearch *s)
+{
+    const double log_total = log((double)s->total_visits + 1.0);
+    unsigned int i, best = 0;
+    double ucb, best_ucb = -1.0;
+    for (i = 0; i < s->nChildren; ++i) {
+        const unsigned long visits = s->children[i].visits;
+        // Visit every child at least once
+        if (visits == 0)
+            return i;
+        const unsigned long wins = s->children[i].wins;
+        ucb = (double)wins / visits +
+                MCTS_EXPLORATION * sqrt(log_total / visits);
+        if (ucb > best_ucb) {
+            best_ucb = ucb;
+            best = i;
+        }
+    }
+    return best;
+}
+
+// Let player take its turn using the rollout strategy
+static enum STATUS _MCTS_play_turn(const _MCTSSearch *s, GameState_t *gstate,
+                                   unsigned int player_id)
+{
+    enum STATUS status;
+    do {
+        status = Strategy_move(s->binfo, gstate, player_id, s->params,
+                               s->board->rollout_strat, false);
+    } while (status == AGAIN);
+    return status;
+}
+
+// Play out game after player moved to destination, drawing the dice from
+// stream dice_seed; returns true if player finishes first
+static bool _MCTS_rollout(_MCTSSearch *s, GameState_t *gstate,
+                          unsigned int destination, uint64_t dice_seed)
+{
+    const unsigned int player_id = s->player_id;
+    unsigned int i, round, start = 0, current_id;
+    enum STATUS status;
+
+    GameState_copy(gstate, s->root);
+    // Future dice of the game are unknown
+    gstate->dice_state = dice_seed;
+    status = GameState_apply_move(s->binfo, gstate, player_id, destination,
+                                  s->dice_roll);
+    if (status == AGAIN) {
+        // Continue as Boeg after capture
+        status = _MCTS_play_turn(s, gstate, player_id);
+    }
+    if (status == GAMEOVER)
+        return true;
+
+    // Remaining players of current round
+    for (i = 0; i < gstate->nPlayers; ++i) {
+        if (gstate->player_order[i] == player_id) {
+            start = i + 1;
+            break;
+        }
+    }
+    for (round = 0; round < MCTS_ROLLOUT_TURNS; ++round) {
+        for (i = start; i < gstate->nPlayers; ++i) {
+            current_id = gstate->player_order[i];
+            if (!is_active_player(gstate, current_id))
+                continue;
+            status = _MCTS_play_turn(s, gstate, current_id);
+            if (status == GAMEOVER)
+                return current_id == player_id;
+        }
+        start = 0;
+    }
+    return false;
+}
+
+static void _MCTS_worker(void *arg, unsigned int worker_id)
+{
+    _MCTSSearch *s = (_MCTSSearch *) arg;
+    _MCTSBoard *board = s->board;
+    GameState_t *gstate = &board->states[worker_id];
+
+    // (Re-)allocate copy of game for current number of players
+    if (board->states_valid[worker_id] && gstate->nPlayers != s->root->nPlayers) {
+        GameState_free(gstate);
+        board->states_valid[worker_id] = false;
+    }
+    if (!board->states_valid[worker_id]) {
+        GameState_init(gstate, s->root->nPlayers, s->binfo->nPositions);
+        board->states_valid[worker_id] = true;
+    }
+
+    unsigned int k;
+    while ((k = atomic_fetch_add(&s->next_rollout, 1)) < s->wave_size) {
+        s->wave_won[k] = _MCTS_rollout(s, gstate,
+                s->children[s->wave_child[k]].pos,
+                derive_seed(s->seed, s->wave_first + k));
+    }
+}
+
+// MCTS STRATEGY:
+// Move to destination that wins most rollouts
+enum STATUS GameState_move_mcts(const BoardInfo_t *binfo,
+            const StrategyCtx_t *ctx, GameState_t *gstate,
+            unsigned int player_id, const AvoidParams_t *params, bool verbose) {
+    // Board context is shared; searches take turns using its workers
+    _MCTSBoard *board = (_MCTSBoard *) ctx->board;
+    _MCTSThread *mcts = (_MCTSThread *) ctx->thread;
+    unsigned int i;
+    // Roll dice
+    int dice_roll = roll_dice(gstate);
+    if (verbose)
+        printf("\n%sDice Roll: %d%s\n\n", PLAYER_COLORS[player_id],
+            dice_roll, DEFAULT_COLOR);
+
+    const unsigned int nMoves = GameState_legal_moves(binfo, gstate, player_id,
+                                                      dice_roll, gstate->moves_buf);
+    assert(nMoves <= mcts->capacity);
+    // Nothing to decide
+    if (nMoves == 1)
+        return GameState_apply_move(binfo, gstate, player_id, gstate->moves_buf[0],
+                                    dice_roll);
+
+    _MCTSSearch s;
+    s.binfo = binfo;
+    s.board = board;
+    s.root = gstate;
+    s.player_id = player_id;
+    s.dice_roll = dice_roll;
+    s.params = params;
+    s.children = mcts->children;
+    s.nChildren = nMoves;
+    s.total_visits = 0;
+    for (i = 0; i < nMoves; ++i) {
+        s.children[i].pos = gstate->moves_buf[i];
+        s.children[i].visits = 0;
+        s.children[i].wins = 0;
+    }
+    // Rollout streams are derived from stream of calling thread
+    s.seed = next();
+    s.wave_child = mcts->wave_child;
+    s.wave_won = mcts->wave_won;
+
+    pthread_mutex_lock(&board->lock);
+    if (!board->initialized)
+        _MCTS_board_start(board);
+    const unsigned long rollouts = board->rollouts;
+    for (s.wave_first = 0; s.wave_first < rollouts; s.wave_first += s.wave_size) {
+        s.wave_size = rollouts - s.wave_first < MCTS_WAVE ?
+                      rollouts - s.wave_first : MCTS_WAVE;
+        // Select children of wave in order (virtual loss)
+        for (unsigned int k = 0; k < s.wave_size; ++k) {
+            const unsigned int c = _MCTS_select(&s);
+            ++s.children[c].visits;
+            ++s.total_visits;
+            s.wave_child[k] = c;
+        }
+        atomic_init(&s.next_rollout, 0);
+        ThreadPool_run(&board->pool, _MCTS_worker, &s);
+        for (unsigned int k = 0; k < s.wave_size; ++k)
+            s.children[s.wave_child[k]].wins += s.wave_won[k];
+    }
+    pthread_mutex_unlock(&board->lock);
+
+    // Play most visited child
+    unsigned int best = 0;
+    unsigned long visits, best_visits = 0;
+    for (i = 0; i < nMoves; ++i) {
+        visits = s.children[i].visits;
+        if (visits > best_visits) {
+            best_visits = visits;
+            best = i;
+        }
+    }
+    if (verbose) {
+        printf("MCTS: %lu rollouts, %u moves, win rate of best move: %.3f\n",
+               rollouts, nMoves, (double)s.children[best].wins / best_visits);
+    }
+    return GameState_apply_move(binfo, gstate, player_id, s.children[best].pos,
+                                dice_roll);
+}
+
+static const Strategy_t STRATEGY_MCTS = {
+    .name = "MCTS",
+    .init = _MCTS_board_init,
+    .free = _MCTS_board_free,
+    .thread_init = _MCTS_thread_init,
+    .thread_free = _MCTS_thread_free,
+    .move = GameState_move_mcts
+};
+
+#endif /* MCTS_H */
@@ -0,0 +1,160 @@
+/*
+ * Latency histograms of moves (see GameState_move).
+ *
+ * - Moves of a game state are timed iff it has a MoveTiming_t attached
+ *   (gstate->timing); every thread owns its game states and therefore its
+ *   histograms, which are merged once a batch is done
+ * - Histograms are keyed by strategy, role (Boeg or player) and the code
+ *   path the strategy took (reported in gstate->move_path)
+ * - Log-linear buckets: exact below 2^LAT_SUB_BITS ns, above that
+ *   2^LAT_SUB_BITS buckets per power of two (relative error below
+ *   2^-LAT_SUB_BITS); count, sum and maximum are exact
+ *
+ * Must be included from game_state.h (needs N_STRATEGIES)
+ */
+
+#pragma once
+#ifndef MOVE_TIMING_H
+#define MOVE_TIMING_H
+
+#ifndef GAME_STATE_H
+#error "move_timing.h needs to be included from game_state.h."
+#endif
+
+#include <stdint.h>
+#include <time.h>  // clock_gettime
+
+#define LAT_SUB_BITS (3)
+#define LAT_MAX_BITS (40)  // up to ~18 minutes
+#define LAT_BUCKETS ((LAT_MAX_BITS - LAT_SUB_BITS + 2) << LAT_SUB_BITS)
+
+// Code path taken by a move
+enum MOVE_PATH {
+    PATH_TARGET,    // target collected or Boeg captured
+    PATH_FOLLOW,    // followed shortest path (towards target or Boeg)
+    PATH_FALLBACK,  // enumerated reachable positions (e.g. path occupied)
+    PATH_SEARCH,    // search / table based strategies
+    N_MOVE_PATHS
+};
+
+static const char *MOVE_PATH_NAMES[N_MOVE_PATHS] = {
+    "target",
+    "follow",
+    "fallback",
+    "search"
+};
+
+typedef struct {
+    uint64_t counts[LAT_BUCKETS];
+    uint64_t n;
+    uint64_t sum_ns;
+    uint64_t max_ns;
+} LatHist_t;
+
+typedef struct {
+    LatHist_t hist[N_STRATEGIES][2][N_MOVE_PATHS];  // [.][isBoeg][path]
+} MoveTiming_t;
+
+static inline uint64_t MoveTiming_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline unsigned int _LatHist_bucket(uint64_t ns)
+{
+    if (ns < (1ULL << LAT_SUB_BITS))
+        return (unsigned int) ns;
+    unsigned int e = 63 - __builtin_clzll(ns);  // ns in [2^e, 2^(e+1))
+    if (e > LAT_MAX_BITS) {
+        e = LAT_MAX_BITS;
+        ns = (2ULL << LAT_MAX_BITS) - 1;
+    }
+    const unsigned int sub = (ns >> (e - LAT_SUB_BITS)) & ((1U << LAT_SUB_BITS) - 1);
+    return ((e - LAT_SUB_BITS + 1) << LAT_SUB_BITS) + sub;
+}
+
+// Smallest value falling into bucket
+static uint64_t _LatHist_lower(unsigned int bucket)
+{
+    if (bucket < (1U << LAT_SUB_BITS))
+        return bucket;
+    const unsigned int e = (bucket >> LAT_SUB_BITS) + LAT_SUB_BITS - 1;
+    const uint64_t sub = bucket & ((1U << LAT_SUB_BITS) - 1);
+    return (1ULL << e) + (sub << (e - LAT_SUB_BITS));
+}
+
+void MoveTiming_init(MoveTiming_t *t)
+{
+    memset(t, 0, sizeof(MoveTiming_t));
+}
+
+static inline void MoveTiming_record(MoveTiming_t *t, enum MOVE_STRATEGY strat,
+        bool isBoeg, enum MOVE_PATH path, uint64_t ns)
+{
+    LatHist_t *h = &t->hist[strat][isBoeg][path];
+    ++h->counts[_LatHist_bucket(ns)];
+    ++h->n;
+    h->sum_ns += ns;
+    if (ns > h->max_ns)
+        h->max_ns = ns;
+}
+
+void MoveTiming_merge(MoveTiming_t *dst, const MoveTiming_t *src)
+{
+    const LatHist_t *s = &src->hist[0][0][0];
+    LatHist_t *d = &dst->hist[0][0][0];
+    for (unsigned int i = 0; i < N_STRATEGIES * 2 * N_MOVE_PATHS; ++i) {
+        for (unsigned int b = 0; b < LAT_BUCKETS; ++b)
+            d[i].counts[b] += s[i].counts[b];
+        d[i].n += s[i].n;
+        d[i].sum_ns += s[i].sum_ns;
+        if (s[i].max_ns > d[i].max_ns)
+            d[i].max_ns = s[i].max_ns;
+    }
+}
+
+// Quantile q of histogram (lower bound of bucket, at most maximum)
+uint64_t LatHist_quantile(const LatHist_t *h, double q)
+{
+    if (h->n == 0)
+        return 0;
+    uint64_t rank = (uint64_t)(q * h->n);
+    rank = rank < h->n ? rank : h->n - 1;
+    uint64_t seen = 0;
+    for (unsigned int b = 0; b < LAT_BUCKETS; ++b) {
+        seen += h->counts[b];
+        if (seen > rank) {
+            const uint64_t lower = _LatHist_lower(b);
+            return lower < h->max_ns ? lower : h->max_ns;
+        }
+    }
+    return h->max_ns;
+}
+
+// Summary of all non-empty histograms (times in microseconds)
+void MoveTiming_print(const MoveTiming_t *t)
+{
+    printf("\nMove latency (us):\n");
+    printf("%-12s %-7s %-9s %12s %10s %10s %10s %10s\n", "strategy", "role",
+           "path", "moves", "mean", "p50", "p99", "max");
+    for (unsigned int s = 0; s < N_STRATEGIES; ++s) {
+        for (unsigned int r = 0; r < 2; ++r) {
+            for (unsigned int p = 0; p < N_MOVE_PATHS; ++p) {
+                const LatHist_t *h = &t->hist[s][r][p];
+                if (h->n == 0)
+                    continue;
+                printf("%-12s %-7s %-9s %12lu %10.3f %10.3f %10.3f %10.3f\n",
+                       STRATEGY_NAMES[s], r ? "Boeg" : "player",
+                       MOVE_PATH_NAMES[p], (unsigned long) h->n,
+                       1e-3 * h->sum_ns / h->n,
+                       1e-3 * LatHist_quantile(h, 0.50),
+                       1e-3 * LatHist_quantile(h, 0.99),
+                       1e-3 * h->max_ns);
+            }
+        }
+    }
+}
+
+#endif /* MOVE_TIMING_H */
@@ -0,0 +1,211 @@
+/*
+ * Hardware performance counters of code regions (Linux perf_event_open).
+ *
+ * - Counts cycles, instructions, L1 data cache read misses, last level
+ *   cache misses and branch misses of the calling thread (user space only)
+ * - Regions: board initialization, APSP (part of board initialization),
+ *   playing the moves of a game and accumulating statistics; counts are
+ *   inclusive, regions may nest
+ * - Disabled unless Perf_init succeeded; then Perf_begin/Perf_end read the
+ *   whole group of counters with a single system call. Events the CPU (or
+ *   VM) does not support are left out
+ * - Counters only follow the thread that called Perf_init, hence profiled
+ *   simulations run on one thread (workers of MCTS are not counted)
+ */
+
+#pragma once
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+enum PERF_REGION {
+    PERF_BOARD_INIT,
+    PERF_APSP,
+    PERF_MOVES,
+    PERF_REDUCE,
+    N_PERF_REGIONS
+};
+
+static const char *PERF_REGION_NAMES[N_PERF_REGIONS] = {
+    "board init",
+    "APSP",
+    "moves",
+    "statistics"
+};
+
+enum PERF_EVENT {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    N_PERF_EVENTS
+};
+
+static const char *PERF_EVENT_NAMES[N_PERF_EVENTS] = {
+    "cycles",
+    "instructions",
+    "L1d misses",
+    "LLC misses",
+    "branch misses"
+};
+
+typedef struct {
+    bool enabled;
+    int leader;                        // file descriptor of group leader
+    int fds[N_PERF_EVENTS];            // -1: event not supported
+    unsigned int slot[N_PERF_EVENTS];  // position of event in group read
+    unsigned int nOpen;
+    uint64_t start[N_PERF_REGIONS][N_PERF_EVENTS];
+    uint64_t total[N_PERF_REGIONS][N_PERF_EVENTS];
+    uint64_t calls[N_PERF_REGIONS];
+} Perf_t;
+
+// Globals
+static Perf_t _perf = { .enabled = false };
+
+#ifdef __linux__
+static int _Perf_open(uint32_t type, uint64_t config, int group)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = group == -1;  // leader starts the whole group
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    return (int) syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+}
+#endif
+
+// Open counters for calling thread; returns false if not available
+bool Perf_init()
+{
+    memset(&_perf, 0, sizeof(Perf_t));
+    _perf.leader = -1;
+#ifdef __linux__
+    const uint32_t types[N_PERF_EVENTS] = {
+        PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+        PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE
+    };
+    const uint64_t configs[N_PERF_EVENTS] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+    for (unsigned int e = 0; e < N_PERF_EVENTS; ++e) {
+        _perf.fds[e] = _Perf_open(types[e], configs[e], _perf.leader);
+        if (_perf.fds[e] == -1)
+            continue;  // not supported
+        if (_perf.leader == -1)
+            _perf.leader = _perf.fds[e];
+        _perf.slot[e] = _perf.nOpen++;
+    }
+    if (_perf.leader == -1) {
+        fprintf(stderr, "Performance counters not available (see "
+                "/proc/sys/kernel/perf_event_paranoid)\n");
+        return false;
+    }
+    ioctl(_perf.leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(_perf.leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    _perf.enabled = true;
+    return true;
+#else
+    fprintf(stderr, "Performance counters need Linux\n");
+    return false;
+#endif
+}
+
+void Perf_free()
+{
+    for (unsigned int e = 0; _perf.enabled && e < N_PERF_EVENTS; ++e) {
+        if (_perf.fds[e] != -1)
+            close(_perf.fds[e]);
+    }
+    _perf.enabled = false;
+}
+
+static inline bool Perf_enabled()
+{
+    return _perf.enabled;
+}
+
+// Current values of all counters (group read)
+static void _Perf_read(uint64_t *values)
+{
+    uint64_t buf[1 + N_PERF_EVENTS];
+    if (read(_perf.leader, buf, sizeof(buf)) < (ssize_t)sizeof(uint64_t)) {
+        memset(values, 0, N_PERF_EVENTS * sizeof(uint64_t));
+        return;
+    }
+    for (unsigned int e = 0; e < N_PERF_EVENTS; ++e)
+        values[e] = _perf.fds[e] != -1 ? buf[1 + _perf.slot[e]] : 0;
+}
+
+static inline void Perf_begin(enum PERF_REGION region)
+{
+    if (_perf.enabled)
+        _Perf_read(_perf.start[region]);
+}
+
+static inline void Perf_end(enum PERF_REGION region)
+{
+    if (!_perf.enabled)
+        return;
+    uint64_t values[N_PERF_EVENTS];
+    _Perf_read(values);
+    for (unsigned int e = 0; e < N_PERF_EVENTS; ++e)
+        _perf.total[region][e] += values[e] - _perf.start[region][e];
+    ++_perf.calls[region];
+}
+
+// Counts per region, in total and per game (games: calls of PERF_MOVES)
+void Perf_print()
+{
+    if (!_perf.enabled)
+        return;
+    const unsigned long nGames = (unsigned long) _perf.calls[PERF_MOVES];
+    printf("\nPerformance counters (user space, %lu games):\n", nGames);
+    for (unsigned int r = 0; r < N_PERF_REGIONS; ++r) {
+        if (_perf.calls[r] == 0)
+            continue;
+        const uint64_t *t = _perf.total[r];
+        printf("%s (%lu calls):\n", PERF_REGION_NAMES[r],
+               (unsigned long) _perf.calls[r]);
+        for (unsigned int e = 0; e < N_PERF_EVENTS; ++e) {
+            if (_perf.fds[e] == -1) {
+                printf("  %-14s %16s\n", PERF_EVENT_NAMES[e], "n/a");
+                continue;
+            }
+            printf("  %-14s %16lu", PERF_EVENT_NAMES[e], (unsigned long) t[e]);
+            if (nGames > 0)
+                printf("  %14.1f / game", (double) t[e] / nGames);
+            if (e != PERF_INSTRUCTIONS && _perf.fds[PERF_INSTRUCTIONS] != -1 &&
+                    t[PERF_INSTRUCTIONS] > 0) {
+                if (e == PERF_CYCLES)
+                    printf("  IPC %.2f", (double) t[PERF_INSTRUCTIONS] / t[e]);
+                else
+                    printf("  %.2f / 1k instr.", 1e3 * t[e] / t[PERF_INSTRUCTIONS]);
+            }
+            printf("\n");
+        }
+    }
+}
+
+#endif /* PERF_COUNTERS_H */
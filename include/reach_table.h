@@ -0,0 +1,100 @@
+/*
+ * Precomputed table of all (unique) vertices reachable from every vertex
+ * of a graph using a simple path of exactly d steps, for d = 1..maxDist.
+ *
+ * - Stored in compressed form: one offsets array indexed by
+ *   (source, distance) pointing into one flat array of vertices
+ * - Vertices of a (source, distance) pair are stored in the same order
+ *   in which Graph_reachable_pos inserts them into its HashMap
+ *
+ * Depends on:
+ * - Graph data structure (adjacency list) + algorithms
+ */
+
+#pragma once
+#ifndef REACH_TABLE_H
+#define REACH_TABLE_H
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#include "graph.h"
+#include "hashmap.h"
+
+typedef struct {
+    unsigned int *offsets;   // (nVert * maxDist + 1) entries
+    unsigned int *vertices;  // reachable vertices of all pairs
+    unsigned int nVert;
+    unsigned int maxDist;
+} ReachTable;
+
+void ReachTable_init(ReachTable *rt, const Graph *graph, bool isBoeg,
+                     unsigned int maxDist)
+{
+    assert(rt && graph && maxDist > 0);
+
+    const unsigned int nVert = graph->nVert;
+    rt->nVert = nVert;
+    rt->maxDist = maxDist;
+    rt->offsets = (unsigned int *) malloc((nVert * maxDist + 1) * sizeof(unsigned int));
+    assert(rt->offsets != NULL);
+
+    // Grow flat vertex array as needed
+    size_t capacity = nVert * maxDist;
+    rt->vertices = (unsigned int *) malloc(capacity * sizeof(unsigned int));
+    assert(rt->vertices != NULL);
+
+    // Work space for DFS
+    bool *visited_buf = (bool *) malloc(nVert * sizeof(bool));
+    assert(visited_buf != NULL);
+    int *distances_buf = (int *) malloc(nVert * sizeof(int));
+    assert(distances_buf != NULL);
+
+    unsigned int size = 0;
+    for (unsigned int source = 0; source < nVert; ++source) {
+        for (unsigned int d = 1; d <= maxDist; ++d) {
+            rt->offsets[source * maxDist + (d - 1)] = size;
+
+            HashMap reachablePos;
+            reachablePos = Graph_reachable_pos(graph, isBoeg, source, d,
+                                               visited_buf, distances_buf);
+            const size_t nReachable = HashMap_size(&reachablePos);
+            if (size + nReachable > capacity) {
+                while (size + nReachable > capacity)
+                    capacity *= 2;
+                rt->vertices = (unsigned int *)
+                        realloc(rt->vertices, capacity * sizeof(unsigned int));
+                assert(rt->vertices != NULL);
+            }
+            for (size_t i = 0; i < nReachable; ++i) {
+                rt->vertices[size++] = HashMap_get(&reachablePos, i);
+            }
+        }
+    }
+    rt->offsets[nVert * maxDist] = size;
+
+    // Cleanup
+    free(visited_buf);
+    free(distances_buf);
+}
+
+// Vertices reachable from source in exactly dist steps; number of
+// vertices is written to count
+const unsigned int *ReachTable_get(const ReachTable *rt, unsigned int source,
+                                   unsigned int dist, unsigned int *count)
+{
+    assert(source < rt->nVert && 1 <= dist && dist <= rt->maxDist);
+
+    const unsigned int i = source * rt->maxDist + (dist - 1);
+    *count = rt->offsets[i + 1] - rt->offsets[i];
+    return &rt->vertices[rt->offsets[i]];
+}
+
+void ReachTable_free(ReachTable *rt)
+{
+    free(rt->offsets);
+    free(rt->vertices);
+}
+
+#endif /* REACH_TABLE_H */
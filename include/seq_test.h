@@ -0,0 +1,160 @@
+/*
+ * Sequential tests on the success probability p of Bernoulli trials
+ * (e.g. games won by a strategy), evaluated at batch boundaries.
+ *
+ * - Hypotheses: H0: p = p0 vs. H1: p = p1 (p1 - p0 is the effect size)
+ * - SPRT (Wald): stops once the log-likelihood ratio leaves
+ *   [log(beta / (1 - alpha)), log((1 - beta) / alpha)]; error rates are
+ *   (approximately) alpha and beta
+ * - Bayesian: uniform prior on p; stops once the posterior probability
+ *   of p exceeding the midpoint of p0 and p1 is above 1 - alpha (H1) or
+ *   below beta (H0)
+ * - Only counts are kept, so tests can be fed with merged statistics
+ */
+
+#pragma once
+#ifndef SEQ_TEST_H
+#define SEQ_TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <math.h>
+
+#define SEQ_BETACF_ITERS (300)
+#define SEQ_BETACF_EPS (1e-14)
+
+enum SEQ_METHOD {
+    SEQ_SPRT,
+    SEQ_BAYES
+};
+
+enum SEQ_DECISION {
+    SEQ_CONTINUE,
+    SEQ_ACCEPT_H0,
+    SEQ_ACCEPT_H1
+};
+
+static const char *SEQ_DECISION_NAMES[] = {
+    "undecided",
+    "H0 accepted",
+    "H1 accepted"
+};
+
+typedef struct {
+    enum SEQ_METHOD method;
+    double p0, p1;
+    double alpha, beta;
+    double lower, upper;  // stopping bounds of statistic
+    unsigned long n;      // trials
+    unsigned long k;      // successes
+} SeqTest_t;
+
+void SeqTest_init(SeqTest_t *test, enum SEQ_METHOD method, double p0,
+                  double p1, double alpha, double beta)
+{
+    if (!(0.0 < p0 && p0 < p1 && p1 < 1.0) ||
+        !(0.0 < alpha && alpha < 0.5) || !(0.0 < beta && beta < 0.5)) {
+        fprintf(stderr, "Invalid sequential test (need 0 < p0 < p1 < 1 "
+                "and error rates in (0, 0.5))\n");
+        exit(EXIT_FAILURE);
+    }
+    test->method = method;
+    test->p0 = p0;
+    test->p1 = p1;
+    test->alpha = alpha;
+    test->beta = beta;
+    test->n = 0;
+    test->k = 0;
+    if (method == SEQ_SPRT) {
+        test->lower = log(beta / (1.0 - alpha));
+        test->upper = log((1.0 - beta) / alpha);
+    } else {
+        test->lower = beta;
+        test->upper = 1.0 - alpha;
+    }
+}
+
+// Continued fraction of incomplete beta function (modified Lentz)
+static double _SeqTest_betacf(double a, double b, double x)
+{
+    const double tiny = 1e-300;
+    double c = 1.0, d = 1.0 - (a + b) * x / (a + 1.0);
+    if (fabs(d) < tiny)
+        d = tiny;
+    d = 1.0 / d;
+    double h = d;
+    for (int m = 1; m <= SEQ_BETACF_ITERS; ++m) {
+        const int m2 = 2 * m;
+        double aa = m * (b - m) * x / ((a + m2 - 1.0) * (a + m2));
+        d = 1.0 + aa * d;
+        if (fabs(d) < tiny)
+            d = tiny;
+        c = 1.0 + aa / c;
+        if (fabs(c) < tiny)
+            c = tiny;
+        d = 1.0 / d;
+        h *= d * c;
+        aa = -(a + m) * (a + b + m) * x / ((a + m2) * (a + m2 + 1.0));
+        d = 1.0 + aa * d;
+        if (fabs(d) < tiny)
+            d = tiny;
+        c = 1.0 + aa / c;
+        if (fabs(c) < tiny)
+            c = tiny;
+        d = 1.0 / d;
+        const double delta = d * c;
+        h *= delta;
+        if (fabs(delta - 1.0) < SEQ_BETACF_EPS)
+            break;
+    }
+    return h;
+}
+
+// Regularized incomplete beta function I_x(a, b)
+double SeqTest_betainc(double a, double b, double x)
+{
+    if (x <= 0.0)
+        return 0.0;
+    if (x >= 1.0)
+        return 1.0;
+    const double front = exp(lgamma(a + b) - lgamma(a) - lgamma(b) +
+                             a * log(x) + b * log1p(-x));
+    if (x < (a + 1.0) / (a + b + 2.0))
+        return front * _SeqTest_betacf(a, b, x) / a;
+    return 1.0 - front * _SeqTest_betacf(b, a, 1.0 - x) / b;
+}
+
+void SeqTest_add(SeqTest_t *test, unsigned long successes, unsigned long trials)
+{
+    assert(successes <= trials);
+    test->k += successes;
+    test->n += trials;
+}
+
+// Log-likelihood ratio (SPRT) or posterior probability of H1 (Bayesian)
+double SeqTest_statistic(const SeqTest_t *test)
+{
+    const double k = test->k, n = test->n;
+    if (test->method == SEQ_SPRT) {
+        return k * log(test->p1 / test->p0) +
+               (n - k) * log((1.0 - test->p1) / (1.0 - test->p0));
+    }
+    // P(p > midpoint | k successes in n trials), posterior Beta(k+1, n-k+1)
+    const double mid = 0.5 * (test->p0 + test->p1);
+    return 1.0 - SeqTest_betainc(k + 1.0, n - k + 1.0, mid);
+}
+
+enum SEQ_DECISION SeqTest_decide(const SeqTest_t *test)
+{
+    if (test->n == 0)
+        return SEQ_CONTINUE;
+    const double stat = SeqTest_statistic(test);
+    if (stat >= test->upper)
+        return SEQ_ACCEPT_H1;
+    if (stat <= test->lower)
+        return SEQ_ACCEPT_H0;
+    return SEQ_CONTINUE;
+}
+
+#endif /* SEQ_TEST_H */
@@ -0,0 +1,325 @@
+/*
+ * Mergeable streaming statistics of simulated games.
+ *
+ * - Constant memory: games are accumulated one at a time, no per-game
+ *   results are stored
+ * - Online mean & variance (Welford) of game lengths and captures,
+ *   fixed-bucket histogram of the round in which the winner finished
+ *   (printed as quantiles and coarse histogram)
+ * - Wins per seat (player id) and per position in turn order, full
+ *   placement distribution per player, number of captures of the Boeg
+ * - Every thread fills its own accumulator; accumulators are combined
+ *   by SimStats_merge (exact, Chan et al. for mean & variance), e.g.
+ *   pairwise along a fixed tree by SimStats_reduce
+ * - PairedStats_t: paired experiments, where the same game (seed) is
+ *   played under two settings A and B (common random numbers); keeps the
+ *   per-game difference, such that its variance excludes the luck of the
+ *   dice shared by both settings
+ *
+ * Must be included from game_state.h (needs GameResult_t & GameState_t)
+ */
+
+#pragma once
+#ifndef SIM_STATS_H
+#define SIM_STATS_H
+
+#ifndef GAME_STATE_H
+#error "sim_stats.h needs to be included from game_state.h."
+#endif
+
+#include <math.h>  // sqrt
+
+// Online mean & variance
+typedef struct {
+    unsigned long n;
+    double mean;
+    double m2;  // sum of squared deviations from mean
+} Welford_t;
+
+static inline void Welford_add(Welford_t *w, double x)
+{
+    ++w->n;
+    const double delta = x - w->mean;
+    w->mean += delta / w->n;
+    w->m2 += delta * (x - w->mean);
+}
+
+void Welford_merge(Welford_t *dst, const Welford_t *src)
+{
+    if (src->n == 0)
+        return;
+    const unsigned long n = dst->n + src->n;
+    const double delta = src->mean - dst->mean;
+    dst->mean += delta * src->n / n;
+    dst->m2 += src->m2 + delta * delta * ((double)dst->n * src->n / n);
+    dst->n = n;
+}
+
+// Sample variance
+double Welford_variance(const Welford_t *w)
+{
+    return w->n > 1 ? w->m2 / (w->n - 1) : 0.0;
+}
+
+typedef struct {
+    unsigned int nPlayers;
+    unsigned long nGames;
+    unsigned long nUndecided;
+    Welford_t win_turns;                  // round in which winner finished
+    Welford_t length;                     // number of rounds played
+    unsigned int min_turns, max_turns;    // of win_turns
+    unsigned long turn_hist[MAX_TURNS + 1];
+    unsigned long seat_wins[MAX_PLAYERS];   // by player id
+    unsigned long order_wins[MAX_PLAYERS];  // by position in turn order
+    // Games player finished in place (last column: did not finish)
+    unsigned long placements[MAX_PLAYERS][MAX_PLAYERS + 1];
+    unsigned long captures[MAX_PLAYERS];
+    Welford_t captures_per_game;
+    unsigned long nMoves;                   // total over all games
+} SimStats_t;
+
+void SimStats_init(SimStats_t *stats, unsigned int nPlayers)
+{
+    memset(stats, 0, sizeof(SimStats_t));
+    stats->nPlayers = nPlayers;
+    stats->min_turns = MAX_TURNS + 1;
+}
+
+// Accumulate result of game that was played on gstate (before reset)
+void SimStats_add(SimStats_t *stats, const GameResult_t *result,
+                  const GameState_t *gstate)
+{
+    unsigned int i, total_captures = 0;
+    bool ranked[MAX_PLAYERS] = {false};
+
+    ++stats->nGames;
+    stats->nMoves += result->nMoves;
+    Welford_add(&stats->length, result->nTurns);
+    if (result->winner == -1) {
+        ++stats->nUndecided;
+    } else {
+        const unsigned int winner = result->winner;
+        Welford_add(&stats->win_turns, result->winTurn);
+        if (result->winTurn < stats->min_turns)
+            stats->min_turns = result->winTurn;
+        if (result->winTurn > stats->max_turns)
+            stats->max_turns = result->winTurn;
+        ++stats->turn_hist[result->winTurn];
+        ++stats->seat_wins[winner];
+        for (i = 0; i < gstate->nPlayers; ++i) {
+            if (gstate->player_order[i] == winner) {
+                ++stats->order_wins[i];
+                break;
+            }
+        }
+    }
+    for (i = 0; i < result->nRanked; ++i) {
+        ++stats->placements[result->ranking[i]][i];
+        ranked[result->ranking[i]] = true;
+    }
+    for (i = 0; i < stats->nPlayers; ++i) {
+        if (!ranked[i])
+            ++stats->placements[i][MAX_PLAYERS];
+        stats->captures[i] += result->captures[i];
+        total_captures += result->captures[i];
+    }
+    Welford_add(&stats->captures_per_game, total_captures);
+}
+
+void SimStats_merge(SimStats_t *dst, const SimStats_t *src)
+{
+    unsigned int i, j;
+    assert(dst->nPlayers == src->nPlayers);
+
+    dst->nGames += src->nGames;
+    dst->nUndecided += src->nUndecided;
+    dst->nMoves += src->nMoves;
+    Welford_merge(&dst->win_turns, &src->win_turns);
+    Welford_merge(&dst->length, &src->length);
+    if (src->min_turns < dst->min_turns)
+        dst->min_turns = src->min_turns;
+    if (src->max_turns > dst->max_turns)
+        dst->max_turns = src->max_turns;
+    for (i = 0; i <= MAX_TURNS; ++i)
+        dst->turn_hist[i] += src->turn_hist[i];
+    for (i = 0; i < MAX_PLAYERS; ++i) {
+        dst->seat_wins[i] += src->seat_wins[i];
+        dst->order_wins[i] += src->order_wins[i];
+        dst->captures[i] += src->captures[i];
+        for (j = 0; j <= MAX_PLAYERS; ++j)
+            dst->placements[i][j] += src->placements[i][j];
+    }
+    Welford_merge(&dst->captures_per_game, &src->captures_per_game);
+}
+
+// Merge n accumulators pairwise along a fixed tree into stats[0]
+void SimStats_reduce(SimStats_t *stats, unsigned int n)
+{
+    for (unsigned int stride = 1; stride < n; stride *= 2) {
+        for (unsigned int i = 0; i + stride < n; i += 2 * stride)
+            SimStats_merge(&stats[i], &stats[i + stride]);
+    }
+}
+
+// Half width of 95% (normal) confidence interval of a proportion
+static inline double _SimStats_ci(unsigned long k, unsigned long n)
+{
+    if (n == 0)
+        return 0.0;
+    const double p = (double)k / n;
+    return 1.96 * sqrt(p * (1.0 - p) / n);
+}
+
+// Quantiles of winning round and histogram over SIM_STATS_HIST_BINS bins
+// spanning [min_turns, max_turns]
+#ifndef SIM_STATS_HIST_BINS
+#define SIM_STATS_HIST_BINS (10)
+#endif
+static void _SimStats_print_turn_hist(const SimStats_t *stats)
+{
+    const unsigned long nWon = stats->nGames - stats->nUndecided;
+    if (nWon == 0)
+        return;
+    const double q[] = {0.1, 0.5, 0.9, 0.99};
+    unsigned int i, t, k = 0;
+    unsigned long cum = 0;
+    printf("Turns (quantiles):");
+    for (t = 0; t <= MAX_TURNS && k < sizeof(q) / sizeof(q[0]); ++t) {
+        cum += stats->turn_hist[t];
+        for (; k < sizeof(q) / sizeof(q[0]) && cum >= q[k] * nWon; ++k)
+            printf("\t%g%%: %u", 100. * q[k], t);
+    }
+    printf("\n");
+
+    const unsigned int lo = stats->min_turns, hi = stats->max_turns;
+    const unsigned int width = (hi - lo) / SIM_STATS_HIST_BINS + 1;
+    unsigned long bin, max_bin = 0;
+    for (t = lo; t <= hi; t += width) {
+        for (bin = 0, i = t; i < t + width && i <= hi; ++i)
+            bin += stats->turn_hist[i];
+        if (bin > max_bin)
+            max_bin = bin;
+    }
+    printf("Turns (histogram):\n");
+    for (t = lo; t <= hi; t += width) {
+        for (bin = 0, i = t; i < t + width && i <= hi; ++i)
+            bin += stats->turn_hist[i];
+        const unsigned int last = t + width - 1 < hi ? t + width - 1 : hi;
+        printf("%4u-%-4u %6.2f%% ", t, last, 100. * bin / nWon);
+        for (i = 0; i < 40 * bin / max_bin; ++i)
+            putchar('#');
+        putchar('\n');
+    }
+}
+
+void SimStats_print(const SimStats_t *stats,
+                    const enum MOVE_STRATEGY *player_strategies)
+{
+    unsigned int i, j;
+    const unsigned long n = stats->nGames;
+
+    printf("Total games played: %lu\n", n);
+    printf("Of which %lu were undecided.\n", stats->nUndecided);
+    printf("\nStatistics:\n");
+    for (i = 0; i < stats->nPlayers; ++i) {
+        printf("%sPlayer: %u\tWins: %lu (%.2f%% +- %.2f%%)\tCaptures: %.2f/game"
+               "\tStrategy: %s%s\n", PLAYER_COLORS[i], i+1, stats->seat_wins[i],
+               100. * stats->seat_wins[i] / n,
+               100. * _SimStats_ci(stats->seat_wins[i], n),
+               (double)stats->captures[i] / n,
+               STRATEGY_NAMES[player_strategies[i]], DEFAULT_COLOR);
+    }
+    printf("\nWins by turn order:\n");
+    for (i = 0; i < stats->nPlayers; ++i) {
+        printf("%u. to move: %.2f%% +- %.2f%%\n", i+1,
+               100. * stats->order_wins[i] / n,
+               100. * _SimStats_ci(stats->order_wins[i], n));
+    }
+    printf("\nPlacements (%%):\n");
+    for (i = 0; i < stats->nPlayers; ++i) {
+        printf("%sPlayer %u:%s", PLAYER_COLORS[i], i+1, DEFAULT_COLOR);
+        for (j = 0; j < stats->nPlayers; ++j)
+            printf("\t%u.: %.2f", j+1, 100. * stats->placements[i][j] / n);
+        printf("\tunfinished: %.2f\n", 100. * stats->placements[i][MAX_PLAYERS] / n);
+    }
+    printf("\nMax. turns: %u\n", stats->max_turns);
+    printf("Min. turns: %u\n", stats->min_turns);
+    printf("Avg. turns: %.2f (std. dev. %.2f)\n", stats->win_turns.mean,
+           sqrt(Welford_variance(&stats->win_turns)));
+    _SimStats_print_turn_hist(stats);
+    printf("Avg. rounds played: %.2f\n", stats->length.mean);
+    printf("Avg. captures: %.2f (std. dev. %.2f)\n", stats->captures_per_game.mean,
+           sqrt(Welford_variance(&stats->captures_per_game)));
+}
+
+// Paired outcomes (e.g. win of player 1) of games played under A and B
+typedef struct {
+    Welford_t a, b;
+    Welford_t diff;          // a - b
+    unsigned long nBetter;   // pairs with a > b
+    unsigned long nWorse;    // pairs with a < b
+} PairedStats_t;
+
+void PairedStats_init(PairedStats_t *stats)
+{
+    memset(stats, 0, sizeof(PairedStats_t));
+}
+
+void PairedStats_add(PairedStats_t *stats, double a, double b)
+{
+    Welford_add(&stats->a, a);
+    Welford_add(&stats->b, b);
+    Welford_add(&stats->diff, a - b);
+    if (a > b)
+        ++stats->nBetter;
+    else if (a < b)
+        ++stats->nWorse;
+}
+
+void PairedStats_merge(PairedStats_t *dst, const PairedStats_t *src)
+{
+    Welford_merge(&dst->a, &src->a);
+    Welford_merge(&dst->b, &src->b);
+    Welford_merge(&dst->diff, &src->diff);
+    dst->nBetter += src->nBetter;
+    dst->nWorse += src->nWorse;
+}
+
+// Merge n accumulators pairwise along a fixed tree into stats[0]
+void PairedStats_reduce(PairedStats_t *stats, unsigned int n)
+{
+    for (unsigned int stride = 1; stride < n; stride *= 2) {
+        for (unsigned int i = 0; i + stride < n; i += 2 * stride)
+            PairedStats_merge(&stats[i], &stats[i + stride]);
+    }
+}
+
+// Half width of 95% (normal) confidence interval of mean difference
+double PairedStats_ci(const PairedStats_t *stats)
+{
+    const unsigned long n = stats->diff.n;
+    return n > 0 ? 1.96 * sqrt(Welford_variance(&stats->diff) / n) : 0.0;
+}
+
+void PairedStats_print(const PairedStats_t *stats)
+{
+    const unsigned long n = stats->diff.n;
+    const double var_a = Welford_variance(&stats->a);
+    const double var_b = Welford_variance(&stats->b);
+    const double var_diff = Welford_variance(&stats->diff);
+
+    printf("Paired games: %lu\n", n);
+    printf("A: %.4f\tB: %.4f\n", stats->a.mean, stats->b.mean);
+    printf("Difference A - B: %.4f +- %.4f (paired)", stats->diff.mean,
+           PairedStats_ci(stats));
+    if (n > 0)
+        printf("\t+- %.4f (independent)", 1.96 * sqrt((var_a + var_b) / n));
+    printf("\nA better: %lu, B better: %lu, tied: %lu\n", stats->nBetter,
+           stats->nWorse, n - stats->nBetter - stats->nWorse);
+    if (var_diff > 0.0) {
+        printf("Variance reduction: %.2fx fewer games than independent runs\n",
+               (var_a + var_b) / var_diff);
+    }
+}
+
+#endif /* SIM_STATS_H */
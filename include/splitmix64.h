@@ -6,8 +6,15 @@
 
 #define SM64_RAND_MAX 0xFFFFFFFFFFFFFFFFLU
 
+// Seed stream of calling thread
 void set_seed(uint64_t);
 
 uint64_t next();
 
+// Draw from explicitly given stream (state is advanced)
+uint64_t next_r(uint64_t *state);
+
+// Seed of independent stream number index derived from master seed
+uint64_t derive_seed(uint64_t master, uint64_t index);
+
 #endif /* SPLITMIX64_H */
@@ -0,0 +1,99 @@
+/*
+ * Strategy interface (vtable) with per-board and per-thread context.
+ *
+ * - init: builds the read-only context of a board (e.g. threat maps,
+ *   tour costs), called once by BoardInfo_init and shared by all threads
+ *   playing on that board
+ * - thread_init: mutable scratch context, created on the first move of a
+ *   game state (every thread owns its game state) and released by
+ *   GameState_free
+ * - move: rolls the dice from the stream of the game state and moves
+ * - free / thread_free: release the respective contexts
+ * - All hooks except move may be NULL (no context needed)
+ * - Every AI strategy has an entry in STRATEGY_TABLE; moves of
+ *   USER_COMMAND are made by GameState_move_command
+ *
+ * Must be included from game_state.h (needs BoardInfo_t & GameState_t)
+ */
+
+#pragma once
+#ifndef STRATEGY_H
+#define STRATEGY_H
+
+#ifndef GAME_STATE_H
+#error "strategy.h needs to be included from game_state.h."
+#endif
+
+// Contexts passed to move
+typedef struct {
+    const void *board;  // read-only, shared among threads
+    void *thread;       // owned by calling thread
+} StrategyCtx_t;
+
+typedef struct {
+    const char *name;
+    void *(*init)(const BoardInfo_t *binfo);
+    void (*free)(void *board_ctx);
+    void *(*thread_init)(const BoardInfo_t *binfo, const void *board_ctx);
+    void (*thread_free)(void *thread_ctx);
+    enum STATUS (*move)(const BoardInfo_t *binfo, const StrategyCtx_t *ctx,
+                        GameState_t *gstate, unsigned int player_id,
+                        const AvoidParams_t *params, bool verbose);
+} Strategy_t;
+
+// Indexed by enum MOVE_STRATEGY (NULL: USER_COMMAND); filled in by
+// game_state.h once the strategies are defined
+static const Strategy_t *STRATEGY_TABLE[N_STRATEGIES];
+
+// Build contexts of all strategies for board (see BoardInfo_init)
+void Strategy_board_init(BoardInfo_t *binfo)
+{
+    for (unsigned int s = 0; s < N_STRATEGIES; ++s) {
+        const Strategy_t *strat = STRATEGY_TABLE[s];
+        binfo->strategy_board[s] = strat != NULL && strat->init != NULL ?
+                strat->init(binfo) : NULL;
+    }
+}
+
+void Strategy_board_free(BoardInfo_t *binfo)
+{
+    for (unsigned int s = 0; s < N_STRATEGIES; ++s) {
+        const Strategy_t *strat = STRATEGY_TABLE[s];
+        if (strat != NULL && strat->free != NULL && binfo->strategy_board[s] != NULL)
+            strat->free(binfo->strategy_board[s]);
+        binfo->strategy_board[s] = NULL;
+    }
+}
+
+// Release per-thread contexts owned by game state (see GameState_free)
+void Strategy_thread_free(GameState_t *gstate)
+{
+    for (unsigned int s = 0; s < N_STRATEGIES; ++s) {
+        const Strategy_t *strat = STRATEGY_TABLE[s];
+        if (strat != NULL && strat->thread_free != NULL &&
+                gstate->strategy_thread[s] != NULL)
+            strat->thread_free(gstate->strategy_thread[s]);
+        gstate->strategy_thread[s] = NULL;
+    }
+}
+
+// Move using vtable of strategy (must have an entry)
+static inline enum STATUS Strategy_move(const BoardInfo_t *binfo,
+        GameState_t *gstate, unsigned int player_id,
+        const AvoidParams_t *params, enum MOVE_STRATEGY move_strat,
+        bool verbose)
+{
+    const Strategy_t *strat = STRATEGY_TABLE[move_strat];
+    assert(strat != NULL);
+    if (strat->thread_init != NULL && gstate->strategy_thread[move_strat] == NULL) {
+        gstate->strategy_thread[move_strat] =
+                strat->thread_init(binfo, binfo->strategy_board[move_strat]);
+    }
+    const StrategyCtx_t ctx = {
+        .board = binfo->strategy_board[move_strat],
+        .thread = gstate->strategy_thread[move_strat]
+    };
+    return strat->move(binfo, &ctx, gstate, player_id, params, verbose);
+}
+
+#endif /* STRATEGY_H */
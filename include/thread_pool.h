@@ -0,0 +1,139 @@
+/*
+ * Simple fork-join thread pool using POSIX threads.
+ *
+ * - Fixed number of worker threads, created once and reused
+ * - ThreadPool_run executes the same job on every worker (with its
+ *   worker id) and blocks until all workers have finished it
+ * - Work distribution among workers is up to the job (e.g. atomic
+ *   counter over work items)
+ *
+ */
+
+#pragma once
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <pthread.h>
+#include <unistd.h>  // sysconf
+
+typedef void (*ThreadPool_job_t)(void *arg, unsigned int worker_id);
+
+typedef struct {
+    pthread_t *threads;
+    unsigned int nThreads;
+    // Current job
+    ThreadPool_job_t job;
+    void *arg;
+    // Synchronization
+    pthread_mutex_t mutex;
+    pthread_cond_t cond_start;
+    pthread_cond_t cond_done;
+    unsigned long generation;  // incremented for every job
+    unsigned int nBusy;
+    bool shutdown;
+} ThreadPool;
+
+typedef struct {
+    ThreadPool *pool;
+    unsigned int worker_id;
+} _ThreadPoolWorker;
+
+// Number of online processors (at least 1)
+unsigned int ThreadPool_num_cores()
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (unsigned int)n : 1;
+}
+
+void *_ThreadPool_worker(void *data)
+{
+    _ThreadPoolWorker worker = *(_ThreadPoolWorker *)data;
+    free(data);
+    ThreadPool *pool = worker.pool;
+    unsigned long seen = 0;
+
+    pthread_mutex_lock(&pool->mutex);
+    while (true) {
+        // Wait for next job (or shutdown)
+        while (!pool->shutdown && pool->generation == seen)
+            pthread_cond_wait(&pool->cond_start, &pool->mutex);
+        if (pool->shutdown)
+            break;
+        seen = pool->generation;
+        ThreadPool_job_t job = pool->job;
+        void *arg = pool->arg;
+        pthread_mutex_unlock(&pool->mutex);
+
+        job(arg, worker.worker_id);
+
+        pthread_mutex_lock(&pool->mutex);
+        if (--pool->nBusy == 0)
+            pthread_cond_signal(&pool->cond_done);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
+}
+
+void ThreadPool_init(ThreadPool *pool, unsigned int nThreads)
+{
+    assert(pool && nThreads > 0);
+
+    pool->nThreads = nThreads;
+    pool->job = NULL;
+    pool->arg = NULL;
+    pool->generation = 0;
+    pool->nBusy = 0;
+    pool->shutdown = false;
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->cond_start, NULL);
+    pthread_cond_init(&pool->cond_done, NULL);
+
+    pool->threads = (pthread_t *) malloc(nThreads * sizeof(pthread_t));
+    assert(pool->threads != NULL);
+    for (unsigned int i = 0; i < nThreads; ++i) {
+        _ThreadPoolWorker *worker =
+                (_ThreadPoolWorker *) malloc(sizeof(_ThreadPoolWorker));
+        assert(worker != NULL);
+        worker->pool = pool;
+        worker->worker_id = i;
+        if (pthread_create(&pool->threads[i], NULL, _ThreadPool_worker, worker)) {
+            fprintf(stderr, "Failed to create worker thread\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+// Run job on all workers and wait for completion
+void ThreadPool_run(ThreadPool *pool, ThreadPool_job_t job, void *arg)
+{
+    pthread_mutex_lock(&pool->mutex);
+    pool->job = job;
+    pool->arg = arg;
+    pool->nBusy = pool->nThreads;
+    ++pool->generation;
+    pthread_cond_broadcast(&pool->cond_start);
+    while (pool->nBusy != 0)
+        pthread_cond_wait(&pool->cond_done, &pool->mutex);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void ThreadPool_free(ThreadPool *pool)
+{
+    pthread_mutex_lock(&pool->mutex);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->cond_start);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (unsigned int i = 0; i < pool->nThreads; ++i)
+        pthread_join(pool->threads[i], NULL);
+    free(pool->threads);
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->cond_start);
+    pthread_cond_destroy(&pool->cond_done);
+}
+
+#endif /* THREAD_POOL_H */
@@ -0,0 +1,185 @@
+/*
+ * Timeline of spans in Chrome trace format (chrome://tracing, Perfetto).
+ *
+ * - Enabled by Trace_init iff the environment variable FANG_TRACE names
+ *   an output file, which is written at exit; otherwise Trace_begin and
+ *   Trace_end are a single (predicted) branch
+ * - A span is recorded once it ends, as complete event with its start and
+ *   duration, hence nested spans need no bookkeeping
+ * - Every thread appends to its own buffer (registered on its first span):
+ *   its first TRACE_HEAD_EVENTS spans are kept (e.g. startup), followed by
+ *   a ring of TRACE_RING_EVENTS spans, in which the oldest are overwritten
+ *   once full. Buffers are only read by Trace_dump, which must not race
+ *   with spans of other threads (e.g. at exit, when pools are idle)
+ * - Names of spans must be string literals (stored by pointer)
+ */
+
+#pragma once
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <pthread.h>
+#include <time.h>  // clock_gettime
+
+#ifndef TRACE_HEAD_EVENTS
+#define TRACE_HEAD_EVENTS (1 << 10)  // per thread
+#endif
+#ifndef TRACE_RING_EVENTS
+#define TRACE_RING_EVENTS (1 << 16)  // per thread, power of two
+#endif
+#define TRACE_ENV "FANG_TRACE"
+
+typedef struct {
+    const char *name;
+    uint64_t start_ns;
+    uint64_t dur_ns;
+} TraceSpan_t;
+
+typedef struct TraceBuf {
+    TraceSpan_t head[TRACE_HEAD_EVENTS];
+    TraceSpan_t ring[TRACE_RING_EVENTS];
+    uint64_t count;  // spans recorded (ring holds the last ones)
+    unsigned int tid;
+    struct TraceBuf *next;
+} TraceBuf_t;
+
+// Globals
+static bool _traceEnabled = false;
+static uint64_t _traceEpoch;  // start of timeline
+static const char *_tracePath = NULL;
+static TraceBuf_t *_traceBufs = NULL;  // buffers of all threads
+static unsigned int _traceThreads = 0;
+static pthread_mutex_t _traceLock = PTHREAD_MUTEX_INITIALIZER;
+static __thread TraceBuf_t *_traceBuf = NULL;  // of calling thread
+
+static inline uint64_t _Trace_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Buffer of calling thread (registered on first use)
+static TraceBuf_t *_Trace_register()
+{
+    TraceBuf_t *buf = (TraceBuf_t *) malloc(sizeof(TraceBuf_t));
+    assert(buf != NULL);
+    buf->count = 0;
+    pthread_mutex_lock(&_traceLock);
+    buf->tid = _traceThreads++;
+    buf->next = _traceBufs;
+    _traceBufs = buf;
+    pthread_mutex_unlock(&_traceLock);
+    _traceBuf = buf;
+    return buf;
+}
+
+static inline bool Trace_enabled()
+{
+    return _traceEnabled;
+}
+
+// Start of span (0 if tracing is disabled)
+static inline uint64_t Trace_begin()
+{
+    return __builtin_expect(_traceEnabled, 0) ? _Trace_now() : 0;
+}
+
+// Record span that began at start (see Trace_begin)
+static inline void Trace_end(const char *name, uint64_t start)
+{
+    if (__builtin_expect(!_traceEnabled, 1))
+        return;
+    const uint64_t end = _Trace_now();
+    TraceBuf_t *buf = _traceBuf != NULL ? _traceBuf : _Trace_register();
+    const uint64_t i = buf->count++;
+    TraceSpan_t *span = i < TRACE_HEAD_EVENTS ? &buf->head[i] :
+            &buf->ring[(i - TRACE_HEAD_EVENTS) & (TRACE_RING_EVENTS - 1)];
+    span->name = name;
+    span->start_ns = start;
+    span->dur_ns = end - start;
+}
+
+static void _Trace_write_span(FILE *fp, const TraceSpan_t *s, unsigned int tid)
+{
+    // Spans that began before tracing are clamped to epoch
+    const uint64_t start = s->start_ns > _traceEpoch ?
+                           s->start_ns - _traceEpoch : 0;
+    fprintf(fp, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, "
+            "\"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}", s->name, tid,
+            1e-3 * start, 1e-3 * s->dur_ns);
+}
+
+// Write spans of all threads as Chrome trace JSON (times in microseconds)
+void Trace_dump(const char *path)
+{
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        fprintf(stderr, "Could not open trace file '%s'\n", path);
+        return;
+    }
+    pthread_mutex_lock(&_traceLock);
+    fprintf(fp, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    bool first = true;
+    uint64_t dropped = 0;
+    for (const TraceBuf_t *buf = _traceBufs; buf != NULL; buf = buf->next) {
+        fprintf(fp, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+                "\"tid\": %u, \"args\": {\"name\": \"thread %u\"}}",
+                first ? "" : ",\n", buf->tid, buf->tid);
+        first = false;
+        const uint64_t nHead = buf->count < TRACE_HEAD_EVENTS ?
+                               buf->count : TRACE_HEAD_EVENTS;
+        for (uint64_t i = 0; i < nHead; ++i)
+            _Trace_write_span(fp, &buf->head[i], buf->tid);
+        // Last spans of ring (in order)
+        const uint64_t nRing = buf->count - nHead < TRACE_RING_EVENTS ?
+                               buf->count - nHead : TRACE_RING_EVENTS;
+        dropped += buf->count - nHead - nRing;
+        for (uint64_t i = buf->count - nHead - nRing; i < buf->count - nHead; ++i)
+            _Trace_write_span(fp, &buf->ring[i & (TRACE_RING_EVENTS - 1)],
+                              buf->tid);
+    }
+    fprintf(fp, "\n]}\n");
+    pthread_mutex_unlock(&_traceLock);
+    fclose(fp);
+    if (dropped > 0)
+        fprintf(stderr, "Trace: %lu oldest spans were overwritten\n",
+                (unsigned long) dropped);
+}
+
+void Trace_free()
+{
+    pthread_mutex_lock(&_traceLock);
+    _traceEnabled = false;
+    while (_traceBufs != NULL) {
+        TraceBuf_t *next = _traceBufs->next;
+        free(_traceBufs);
+        _traceBufs = next;
+    }
+    pthread_mutex_unlock(&_traceLock);
+    _traceBuf = NULL;  // buffers of other threads are gone as well
+}
+
+static void _Trace_atexit()
+{
+    Trace_dump(_tracePath);
+    Trace_free();
+}
+
+// Enable tracing if FANG_TRACE is set (call once, before other threads)
+void Trace_init()
+{
+    _tracePath = getenv(TRACE_ENV);
+    if (_tracePath == NULL || _tracePath[0] == '\0')
+        return;
+    _traceEpoch = _Trace_now();
+    _traceEnabled = true;
+    atexit(_Trace_atexit);
+}
+
+#endif /* TRACE_H */
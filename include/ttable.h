@@ -0,0 +1,74 @@
+/*
+ * Lock-free, fixed-size transposition table keyed on 64-bit hashes.
+ *
+ * - Direct-mapped: the lower bits of the key select the only entry a key
+ *   can occupy; stores always replace
+ * - Every entry holds (key ^ data, data) in two relaxed atomic words, so
+ *   readers and writers never block; a torn entry written concurrently by
+ *   two threads fails the key check on probe and is treated as a miss
+ * - One 64-bit data word per entry; packing of values is up to the user
+ */
+
+#pragma once
+#ifndef TTABLE_H
+#define TTABLE_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include <stdatomic.h>
+
+typedef struct {
+    _Atomic uint64_t check;  // key ^ data
+    _Atomic uint64_t data;
+} TTableEntry;
+
+typedef struct {
+    TTableEntry *entries;
+    uint64_t mask;  // number of entries - 1
+} TTable;
+
+// Allocate table with 2^bits (empty) entries
+void TTable_init(TTable *tt, unsigned int bits)
+{
+    assert(tt && bits < 64);
+
+    tt->mask = (1ULL << bits) - 1;
+    tt->entries = (TTableEntry *) calloc(tt->mask + 1, sizeof(TTableEntry));
+    assert(tt->entries != NULL);
+}
+
+// Remove all entries; must not run concurrently with probes or stores
+void TTable_clear(TTable *tt)
+{
+    memset(tt->entries, 0, (tt->mask + 1) * sizeof(TTableEntry));
+}
+
+// Look up key; writes stored data and returns true if present
+static inline bool TTable_probe(const TTable *tt, uint64_t key, uint64_t *data)
+{
+    TTableEntry *entry = &tt->entries[key & tt->mask];
+    const uint64_t d = atomic_load_explicit(&entry->data, memory_order_relaxed);
+    const uint64_t c = atomic_load_explicit(&entry->check, memory_order_relaxed);
+    if ((c ^ d) != key)
+        return false;
+    *data = d;
+    return true;
+}
+
+static inline void TTable_store(TTable *tt, uint64_t key, uint64_t data)
+{
+    TTableEntry *entry = &tt->entries[key & tt->mask];
+    atomic_store_explicit(&entry->check, key ^ data, memory_order_relaxed);
+    atomic_store_explicit(&entry->data, data, memory_order_relaxed);
+}
+
+void TTable_free(TTable *tt)
+{
+    free(tt->entries);
+    tt->entries = NULL;
+}
+
+#endif /* TTABLE_H */
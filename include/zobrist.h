@@ -0,0 +1,41 @@
+/*
+ * Zobrist keys for hashing states of the game.
+ *
+ * - The hash of a state is the XOR of one key per feature: position of
+ *   every player, position and owner of the Boeg, every target slot that
+ *   is still active (together with its target) and the turn order
+ * - Keys are not stored in tables but computed on the fly by mixing
+ *   (feature, index, value) with the splitmix64 finalizer; works for
+ *   boards of any size and costs a few multiplications
+ * - Changing a single feature updates the hash in O(1) by XORing out the
+ *   old and XORing in the new key (see setters in game_state.h)
+ */
+
+#pragma once
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <stdint.h>
+
+// Fixed seed such that hashes are reproducible across runs
+#define ZOBRIST_SEED (0x9e3779b97f4a7c15ULL)
+
+enum ZOBRIST_FEATURE {
+    ZOBRIST_PLAYER_POS = 1,  // (player, position)
+    ZOBRIST_BOEG_POS,        // (0, position)
+    ZOBRIST_BOEG_ID,         // (0, id of owner)
+    ZOBRIST_TARGET,          // (target slot, target)
+    ZOBRIST_ORDER            // (turn, player)
+};
+
+static inline uint64_t Zobrist_key(enum ZOBRIST_FEATURE feature,
+                                   uint32_t index, uint32_t value)
+{
+    uint64_t z = ZOBRIST_SEED ^ ((uint64_t)feature << 56) ^
+            ((uint64_t)index << 32) ^ value;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+#endif /* ZOBRIST_H */
@@ -13,7 +13,6 @@
 #include "splitmix64.h"
 
 #define TEXT_BUF_SIZE 32
-#define BASE_AVOIDANCE 40.0
 
 // Globals
 static GLuint nNodes = 0;
@@ -21,8 +20,9 @@ static GLuint nEdges = 0;
 static BoardInfo_t binfo;
 static GameState_t gstate;
 static GLuint _userId = MAX_PLAYERS;
-static GLuint _playerTurnId = MAX_PLAYERS;
-static GLuint _playerTurnIter = 0;
+static GameStepper_t _stepper;  // whose turn it is
+static AvoidParams_t _playerParams[MAX_PLAYERS];
+static MoveTiming_t _moveTiming;  // latency of AI moves (printed on quit)
 static GLint _userDiceRoll = 0;
 static vec3 targetBgCol[N_TARGETS_PLAYER];
 static const char *locationText = "";
@@ -105,17 +105,9 @@ void updateNodeColors()
     glutPostRedisplay();
 }
 
-void updateTurnId()
-{
-    // Update iterator periodically and set player turn id accordingly
-    do {
-        _playerTurnIter = (_playerTurnIter + 1) % gstate.nPlayers;
-        _playerTurnId = gstate.player_order[_playerTurnIter];
-    } while (!is_active_player(&gstate, _playerTurnId));
-}
-
 void draw()
 {
+    const uint64_t span = Trace_begin();
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     
     // If game is over, write text to screen
@@ -147,10 +139,7 @@ void draw()
                                COLORS[_userId], targetBgCol[i]);
     }
     
-    // Draw board
-    renderBoard(nNodes, nEdges);
-    
-    // Render text
+    // Queue remaining text
     // Write name of location in bottom corner
     fontRenderText(locationText, 20.0f, 20.0f, 0.8f, 
                    COLORS[COL_TEXT], COLORS[COL_BG]);
@@ -194,8 +183,12 @@ void draw()
         }
         dispY -= 1.5f*td.height;
     }
+    // Draw all text in one call, then board (text drawn first stays on top)
+    fontFlush();
+    renderBoard(nNodes, nEdges);
     // Swap buffers and show the buffer's content on the screen
     glutSwapBuffers();
+    Trace_end("draw", span);
 }
 
 void keyPressed(unsigned char key, int x, int y)
@@ -206,6 +199,7 @@ void keyPressed(unsigned char key, int x, int y)
     
     if (key == 'q' || key == 'Q') {
         // Quit
+        MoveTiming_print(&_moveTiming);
         exit(EXIT_SUCCESS);
     } else if (_isGameover && (key == 'r' || key == 'R')) {
         // Require playerTurnId to be re-initialized
@@ -228,8 +222,12 @@ void mouseClick(int button, int state, int x, int y)
                                 state == GLUT_DOWN;
     const GLboolean rightClick = button == GLUT_RIGHT_BUTTON &&
                                  state == GLUT_DOWN;
+    const GLboolean userTurn = _isInitialized && !_stepper.done &&
+                               GameStepper_player(&_stepper, &gstate) == _userId;
+    // Moves need all tables of board (returns at once after first click)
+    BoardInfo_wait(&binfo);
     
-    if (_playerTurnId == _userId && _userDiceRoll && leftClick) {
+    if (userTurn && _userDiceRoll && leftClick) {
         // Get current window sizes
         GLfloat width = glutGet(GLUT_WINDOW_WIDTH);
         GLfloat height = glutGet(GLUT_WINDOW_HEIGHT);
@@ -250,89 +248,72 @@ void mouseClick(int button, int state, int x, int y)
                 enum STATUS userStatus = INVALID;
                 userStatus = GameState_move_command(&binfo, &gstate,
                                                         _userId, i, _userDiceRoll);
-                if (userStatus != INVALID) {
-                    // Set clicked location name
-                    locationText = binfo.locations[i].name;
-                    // Update colors of nodes
-                    updateNodeColors();
+                if (userStatus == INVALID) {
+                    break;  // try again
                 }
+                // Set clicked location name
+                locationText = binfo.locations[i].name;
+                // Advance turn (same bookkeeping as headless games)
+                GameStepper_record(&_stepper, &gstate, userStatus);
+                // Update colors of nodes
+                updateNodeColors();
                 
-                if (userStatus == CONTINUE) {
-                    updateTurnId();
-                    // Reset user dice roll
-                    _userDiceRoll = 0;
-                } else if (userStatus == AGAIN) {
+                if (userStatus == AGAIN) {
                     // Roll dice again
-                    _userDiceRoll = roll_dice();
+                    _userDiceRoll = roll_dice(&gstate);
                     glutPostRedisplay();
                 } else if (userStatus == GAMEOVER) {
                     _isGameover = GL_TRUE;
-                    // TODO: Determine placement among all players
-                    printf("You won! <3\n");
-                    _playerTurnId = MAX_PLAYERS;
+                    if (_stepper.nFinished == 1)
+                        printf("You won! <3\n");
+                    else
+                        printf("You finished in place %u\n", _stepper.nFinished);
                     _userDiceRoll = 0;
                     glutPostRedisplay();
+                } else {
+                    // Reset user dice roll
+                    _userDiceRoll = 0;
+                    _isGameover = _stepper.done;
                 }
+                break;
             }
         }
     } else if (rightClick) {
         // Initialization
         if (!_isInitialized) {
-            // Initialize id of player to move first
-            _playerTurnIter = 0;
-            _playerTurnId = gstate.player_order[_playerTurnIter];
+            // Player to move first
+            GameStepper_init(&_stepper, &gstate, false);
             _isInitialized = GL_TRUE;
-        } else if (_playerTurnId == MAX_PLAYERS) {
+        } else if (_isGameover || _stepper.done) {
             return;  // skip
         }
         
-        if (_playerTurnId == _userId && _userDiceRoll == 0) {
+        const GLuint playerId = GameStepper_player(&_stepper, &gstate);
+        if (playerId == _userId && _userDiceRoll == 0) {
             // User's turn
             // Roll dice
-            _userDiceRoll = roll_dice();
+            _userDiceRoll = roll_dice(&gstate);
             glutPostRedisplay();
-        } else if (_playerTurnId != _userId) {
+        } else if (playerId != _userId) {
             // AI's turn
-            if (is_active_player(&gstate, _playerTurnId)) {                
-                GLboolean capturedUser = GL_FALSE;
-                enum STATUS aiStatus = INVALID;
-                capturedUser = _userId == gstate.boeg_id;
-                aiStatus = GameState_move(&binfo, &gstate, _playerTurnId, 
-                                            BASE_AVOIDANCE, 
-                                            player_strategies[_playerTurnId], false);
-                assert(aiStatus != INVALID);
-                capturedUser = capturedUser && _userId != gstate.boeg_id;
-                
-                if (capturedUser) {
-                    // Change player location text to point back to
-                    // original location of user
-                    const GLuint userPos = gstate.player_pos[_userId];
-                    locationText = binfo.locations[userPos].name;
-                }
-                // Update colors of nodes
-                updateNodeColors();
-                
-                if (aiStatus == CONTINUE) {
-                    updateTurnId();
-                } else if (aiStatus == GAMEOVER) {
-                    // Check if user has lost
-                    _isGameover = GL_TRUE;
-                    for (GLuint i = 0; i < gstate.nPlayers; ++i) {
-                        if (i != _userId && gstate.player_targets_left[i] > 0) {
-                            _isGameover = GL_FALSE;
-                            break;
-                        }
-                    }
-                    
-                    if (_isGameover) {
-                        _playerTurnId = MAX_PLAYERS;
-                        glutPostRedisplay();
-                    } else {
-                        updateTurnId();
-                    }
-                }
-            } else {
-                updateTurnId();
+            GLboolean capturedUser = _userId == gstate.boeg_id;
+            GameStepper_step(&binfo, &_stepper, &gstate, player_strategies,
+                             _playerParams, false);
+            capturedUser = capturedUser && _userId != gstate.boeg_id;
+            
+            if (capturedUser) {
+                // Change player location text to point back to
+                // original location of user
+                const GLuint userPos = gstate.player_pos[_userId];
+                locationText = binfo.locations[userPos].name;
+            }
+            // Update colors of nodes
+            updateNodeColors();
+            
+            // User has lost (or maximum number of turns reached)
+            if (_stepper.done) {
+                _isGameover = GL_TRUE;
+                glutPostRedisplay();
             }
         }
     }
@@ -341,7 +322,7 @@ void mouseClick(int button, int state, int x, int y)
 int main(int argc, char *argv[]) {
     
     if (argc < 2) {
-        fprintf(stderr, "Usage: ./fang <num_players %d:%d> <list of player strategies (a/g/u)>\n",
+        fprintf(stderr, "Usage: ./fang <num_players %d:%d> <list of player strategies (a/e/g/m/t/u)>\n",
                                 MIN_PLAYERS, MAX_PLAYERS);
         exit(EXIT_FAILURE);
     }
@@ -349,11 +330,13 @@ int main(int argc, char *argv[]) {
     // Seed (pseudo-) random number generator
     set_seed(time(NULL));
     //set_seed(42);
+    // Timeline of spans, if FANG_TRACE names an output file
+    Trace_init();
     
     unsigned int nPlayers = atoi(argv[1]);
     if (!(MIN_PLAYERS <= nPlayers && nPlayers <= MAX_PLAYERS)) {
         fprintf(stderr, "Invalid number of players\n");
-        fprintf(stderr, "Usage: ./fang <num_players %d:%d> <list of player strategies (a,g,u)>\n",
+        fprintf(stderr, "Usage: ./fang <num_players %d:%d> <list of player strategies (a,e,g,m,t,u)>\n",
                                 MIN_PLAYERS, MAX_PLAYERS);
         exit(EXIT_FAILURE);
     }
@@ -361,7 +344,7 @@ int main(int argc, char *argv[]) {
     
     if (argc - 2 != (int)nPlayers) {
         fprintf(stderr, "Need to specify list of player strategies for exactly %u players\n", nPlayers);
-        fprintf(stderr, "Supported strategies: a(voidant), g(reedy), u(ser_command)\n");
+        fprintf(stderr, "Supported strategies: a(voidant), e(xpectimax), g(reedy), m(cts), t(able), u(ser_command)\n");
         exit(EXIT_FAILURE);
     }
     
@@ -378,9 +361,18 @@ int main(int argc, char *argv[]) {
             case 'a':
                 player_strategies[i] = AVOIDANT;
                 break;
+            case 'e':
+                player_strategies[i] = EXPECTIMAX;
+                break;
             case 'g':
                 player_strategies[i] = GREEDY;
                 break;
+            case 'm':
+                player_strategies[i] = MCTS;
+                break;
+            case 't':
+                player_strategies[i] = ENDGAME;
+                break;
             case 'u':
                 player_strategies[i] = USER_COMMAND;
                 break;
@@ -412,16 +404,35 @@ int main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     }
     
-    // Initialize board
-    BoardInfo_init(&binfo);
+    // Initialize board (shortest paths etc. are computed in the background,
+    // while the window is set up; see mouseClick)
+    BoardInfo_init_lazy(&binfo, BOARD_DIR);
     nNodes = binfo.nPositions;
     nEdges = binfo.graph.nEdge;
     
     // Initialize board
     initBoardGL(&argc, argv, "fonts/LiberationMono-Regular.ttf", &binfo);
     
+    // Load endgame tables for ENDGAME players (EXPECTIMAX keeps its tour
+    // leaf); others need not wait for the board
+    for (i = 0; i < nPlayers; ++i) {
+        if (player_strategies[i] == ENDGAME && !Endgame_load(&binfo)) {
+            fprintf(stderr, "Could not load endgame tables (run 'make endgame')\n");
+            BoardInfo_free(&binfo);
+            free(player_strategies);
+            exit(EXIT_FAILURE);
+        }
+    }
+    
     // Initialize game state
     GameState_init(&gstate, nPlayers, nNodes);
+    // All AI players use default parameters
+    for (i = 0; i < nPlayers; ++i) {
+        _playerParams[i] = AVOID_PARAMS_DEFAULT;
+    }
+    // Record latency of moves
+    MoveTiming_init(&_moveTiming);
+    gstate.timing = &_moveTiming;
     
     // Initialize target background color
     for (GLuint i = 0; i < N_TARGETS_PLAYER; ++i)
@@ -440,7 +451,7 @@ int main(int argc, char *argv[]) {
     // Start main loop
     glutMainLoop();
     
-    //GameState_run(&binfo, &gstate, player_strategies, false, true);
+    //GameState_run(&binfo, &gstate, player_strategies, player_params, false, true);
     //GameState_statistics(&binfo, &gstate, player_strategies, 1024);
     // Clean up board info and game state
     BoardInfo_free(&binfo);
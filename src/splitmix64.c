@@ -1,14 +1,26 @@
 #include "splitmix64.h"
 
 // State (arbitrary) -> reproducibility
-static uint64_t x = 327;
+// Thread-local: every thread draws from its own stream (seed via set_seed)
+static _Thread_local uint64_t x = 327;
 
 void set_seed(uint64_t seed) {
     x = seed;
 }
 
 uint64_t next() {
-    uint64_t z = (x += 0x9e3779b97f4a7c15);
+    return next_r(&x);
+}
+
+uint64_t next_r(uint64_t *state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+	return z ^ (z >> 31);
+}
+
+uint64_t derive_seed(uint64_t master, uint64_t index) {
+    uint64_t z = master ^ (index * 0xd1b54a32d192ed03);
 	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
 	z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
 	return z ^ (z >> 31);
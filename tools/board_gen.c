@@ -0,0 +1,349 @@
+/*
+ * Generator of synthetic boards for stress & scaling tests.
+ *
+ * - Writes graph.txt (format of Graph_init_file), locations.txt and
+ *   targets.txt (number of targets) into an output directory, which can
+ *   be loaded with BoardInfo_init_dir
+ * - Layouts:
+ *   grid:   rows of a square grid
+ *   planar: jittered grid with randomly dropped sides & one random
+ *           diagonal per cell (edges never cross)
+ *   hub:    ring of hubs, each with spokes (paths) of given length whose
+ *           tips are joined into a rim
+ * - The player graph stays connected: Boeg-only edges (fraction of all
+ *   edges, as far as possible) and dropped edges are only taken among the
+ *   edges outside of a fixed spanning tree
+ * - Targets are spread uniformly over all vertices and relabeled to
+ *   0, ..., targets-1 (the engine refuses boards with other than
+ *   N_TARGETS of them)
+ * - Output only depends on the arguments (seed)
+ *
+ * Usage: ./board_gen [-l grid|planar|hub] [-n vertices] [-b boeg fraction]
+ *                    [-T targets] [-L spoke length] [-S spokes per hub]
+ *                    [-s seed] output_dir
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <errno.h>
+#include <unistd.h>    // getopt
+#include <sys/stat.h>  // mkdir
+
+#include "splitmix64.h"
+
+#define GEN_MIN_VERTICES (50)
+#define GEN_MAX_VERTICES (1000000)
+#define GEN_MIN_TARGETS (25)  // targets of 6 players & Boeg
+#define GEN_DEFAULT_TARGETS (40)  // N_TARGETS of engine
+// Spokes of a hub are reachable in the same number of steps (bounded by
+// the capacity of HashMap used by Graph_reachable_pos)
+#define GEN_MAX_SPOKES (64)
+// Probability to keep a side of a cell (planar layout)
+#define GEN_PLANAR_KEEP (0.7)
+
+enum LAYOUT {
+    LAYOUT_GRID,
+    LAYOUT_PLANAR,
+    LAYOUT_HUB
+};
+
+typedef struct {
+    unsigned int u, v;
+    bool isTree;      // part of spanning tree (kept for players)
+    bool isBoegOnly;
+} GenEdge;
+
+typedef struct {
+    unsigned int nVert;
+    float *pos;       // 2 coordinates per vertex in [-1,1]
+    GenEdge *edges;
+    unsigned int nEdge;
+    unsigned int capacity;
+} GenBoard;
+
+static double uniform()
+{
+    return (next() >> 11) * 0x1.0p-53;
+}
+
+static void add_edge(GenBoard *b, unsigned int u, unsigned int v, bool isTree)
+{
+    if (b->nEdge == b->capacity) {
+        b->capacity *= 2;
+        b->edges = (GenEdge *) realloc(b->edges, b->capacity * sizeof(GenEdge));
+        assert(b->edges != NULL);
+    }
+    b->edges[b->nEdge++] = (GenEdge) {.u = u, .v = v, .isTree = isTree,
+                                      .isBoegOnly = false};
+}
+
+static void set_pos(GenBoard *b, unsigned int v, double x, double y)
+{
+    b->pos[2 * v] = (float) fmin(1.0, fmax(-1.0, x));
+    b->pos[2 * v + 1] = (float) fmin(1.0, fmax(-1.0, y));
+}
+
+// Grid of rows (last row possibly incomplete); spanning tree consists of
+// all rows plus the first column
+static void gen_grid(GenBoard *b, bool planar)
+{
+    const unsigned int n = b->nVert;
+    const unsigned int w = (unsigned int) ceil(sqrt((double) n));
+    const double cell = 1.9 / (w > 1 ? w - 1 : 1);
+
+    for (unsigned int v = 0; v < n; ++v) {
+        const unsigned int r = v / w, c = v % w;
+        double x = -0.95 + c * cell, y = 0.95 - r * cell;
+        if (planar) {
+            // Jitter within a third of a cell keeps cells convex
+            x += (uniform() - 0.5) * cell / 3.0;
+            y += (uniform() - 0.5) * cell / 3.0;
+        }
+        set_pos(b, v, x, y);
+    }
+    for (unsigned int v = 0; v < n; ++v) {
+        const unsigned int c = v % w;
+        const bool right = c + 1 < w && v + 1 < n;
+        const bool down = v + w < n;
+        if (right)
+            add_edge(b, v, v + 1, true);
+        if (down && (c == 0 || !planar || uniform() < GEN_PLANAR_KEEP))
+            add_edge(b, v, v + w, c == 0);
+        // One diagonal per complete cell
+        if (planar && right && v + w + 1 < n && uniform() < 0.5) {
+            if (uniform() < 0.5)
+                add_edge(b, v, v + w + 1, false);
+            else
+                add_edge(b, v + 1, v + w, false);
+        }
+    }
+}
+
+// Ring of hubs with spokes; spanning tree consists of spokes and the ring
+// without its closing edge
+static void gen_hub(GenBoard *b, unsigned int spokeLen, unsigned int nSpokes)
+{
+    const unsigned int n = b->nVert;
+    const unsigned int perHub = 1 + spokeLen * nSpokes;
+    const unsigned int nHubs = (n + perHub - 1) / perHub;
+    const double hubRadius = nHubs > 1 ? 0.5 : 0.0;
+    const double spokeStep = 0.45 / (spokeLen * sqrt((double) nHubs));
+
+    unsigned int v = 0, prevHub = 0;
+    for (unsigned int h = 0; h < nHubs && v < n; ++h) {
+        const double angle = 2.0 * M_PI * h / nHubs;
+        const double hx = hubRadius * cos(angle), hy = hubRadius * sin(angle);
+        const unsigned int hub = v++;
+        set_pos(b, hub, hx, hy);
+        if (h > 0)
+            add_edge(b, prevHub, hub, true);
+        prevHub = hub;
+
+        unsigned int prevTip = n;  // none
+        for (unsigned int s = 0; s < nSpokes && v < n; ++s) {
+            const double a = 2.0 * M_PI * (s + 0.5) / nSpokes;
+            unsigned int prev = hub;
+            for (unsigned int k = 1; k <= spokeLen && v < n; ++k) {
+                set_pos(b, v, hx + k * spokeStep * cos(a), hy + k * spokeStep * sin(a));
+                add_edge(b, prev, v, true);
+                prev = v++;
+            }
+            // Rim joining tips of neighboring spokes
+            if (prevTip != n)
+                add_edge(b, prevTip, prev, false);
+            prevTip = prev;
+        }
+    }
+    if (nHubs > 2)
+        add_edge(b, prevHub, 0, false);  // close ring
+}
+
+// Mark random non-tree edges as Boeg-only; returns number of marked edges
+static unsigned int mark_boeg_edges(GenBoard *b, double fraction)
+{
+    unsigned int nCandidates = 0;
+    for (unsigned int e = 0; e < b->nEdge; ++e)
+        nCandidates += !b->edges[e].isTree;
+    unsigned int nWanted = (unsigned int) (fraction * b->nEdge + 0.5);
+    if (nWanted > nCandidates)
+        nWanted = nCandidates;
+    // Selection sampling (Knuth's algorithm S) over candidates
+    unsigned int nMarked = 0, nSeen = 0;
+    for (unsigned int e = 0; e < b->nEdge && nMarked < nWanted; ++e) {
+        if (b->edges[e].isTree)
+            continue;
+        if ((nCandidates - nSeen) * uniform() < nWanted - nMarked) {
+            b->edges[e].isBoegOnly = true;
+            ++nMarked;
+        }
+        ++nSeen;
+    }
+    return nMarked;
+}
+
+// New vertex ids: sampled targets first, remaining vertices in order
+static unsigned int *relabel(unsigned int n, unsigned int nTargets)
+{
+    unsigned int *perm = (unsigned int *) malloc(n * sizeof(unsigned int));
+    unsigned int *label = (unsigned int *) malloc(n * sizeof(unsigned int));
+    bool *isTarget = (bool *) calloc(n, sizeof(bool));
+    assert(perm && label && isTarget);
+    for (unsigned int i = 0; i < n; ++i)
+        perm[i] = i;
+    // Partial Fisher-Yates shuffle
+    for (unsigned int i = 0; i < nTargets; ++i) {
+        const unsigned int j = i + next() % (n - i);
+        const unsigned int tmp = perm[i];
+        perm[i] = perm[j];
+        perm[j] = tmp;
+        isTarget[perm[i]] = true;
+    }
+    unsigned int nextId = nTargets;
+    for (unsigned int i = 0; i < nTargets; ++i)
+        label[perm[i]] = i;
+    for (unsigned int v = 0; v < n; ++v) {
+        if (!isTarget[v])
+            label[v] = nextId++;
+    }
+    free(perm);
+    free(isTarget);
+    return label;
+}
+
+static FILE *open_output(const char *dir, const char *name)
+{
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        fprintf(stderr, "Could not open '%s'\n", path);
+        exit(EXIT_FAILURE);
+    }
+    return fp;
+}
+
+static void write_board(const GenBoard *b, const unsigned int *label,
+                        unsigned int nTargets, const char *dir)
+{
+    FILE *fp = open_output(dir, "graph.txt");
+    fprintf(fp, "u\n%u\n", b->nVert);
+    for (unsigned int e = 0; e < b->nEdge; ++e) {
+        const GenEdge *edge = &b->edges[e];
+        fprintf(fp, "%u %u %d\n", label[edge->u], label[edge->v], edge->isBoegOnly);
+    }
+    fclose(fp);
+
+    // Locations in order of new ids
+    unsigned int *vertex = (unsigned int *) malloc(b->nVert * sizeof(unsigned int));
+    assert(vertex != NULL);
+    for (unsigned int v = 0; v < b->nVert; ++v)
+        vertex[label[v]] = v;
+    fp = open_output(dir, "locations.txt");
+    for (unsigned int i = 0; i < b->nVert; ++i) {
+        const unsigned int v = vertex[i];
+        fprintf(fp, "%s %u,%.6f,%.6f\n", i < nTargets ? "Target" : "Position",
+                i, b->pos[2 * v], b->pos[2 * v + 1]);
+    }
+    fclose(fp);
+    free(vertex);
+
+    fp = open_output(dir, "targets.txt");
+    fprintf(fp, "%u\n", nTargets);
+    fclose(fp);
+}
+
+int main(int argc, char *argv[]) {
+
+    enum LAYOUT layout = LAYOUT_GRID;
+    unsigned long nVert = 1000;
+    double boegFraction = 0.05;
+    unsigned int nTargets = GEN_DEFAULT_TARGETS;
+    unsigned int spokeLen = 8;
+    unsigned int nSpokes = 16;
+    uint64_t seed = 42;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "l:n:b:T:L:S:s:")) != -1) {
+        switch (opt) {
+            case 'l':
+                if (strcmp(optarg, "grid") == 0) {
+                    layout = LAYOUT_GRID;
+                } else if (strcmp(optarg, "planar") == 0) {
+                    layout = LAYOUT_PLANAR;
+                } else if (strcmp(optarg, "hub") == 0) {
+                    layout = LAYOUT_HUB;
+                } else {
+                    fprintf(stderr, "Did not recognize layout: '%s'\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'n': nVert = strtoul(optarg, NULL, 10); break;
+            case 'b': boegFraction = atof(optarg); break;
+            case 'T': nTargets = atoi(optarg); break;
+            case 'L': spokeLen = atoi(optarg); break;
+            case 'S': nSpokes = atoi(optarg); break;
+            case 's': seed = strtoull(optarg, NULL, 10); break;
+            default:
+                fprintf(stderr, "Usage: ./board_gen [-l grid|planar|hub] [-n vertices] "
+                        "[-b boeg fraction] [-T targets] [-L spoke length] "
+                        "[-S spokes per hub] [-s seed] output_dir\n");
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "Need output directory\n");
+        exit(EXIT_FAILURE);
+    }
+    const char *dir = argv[optind];
+    if (nVert < GEN_MIN_VERTICES || nVert > GEN_MAX_VERTICES) {
+        fprintf(stderr, "Need %d to %d vertices\n", GEN_MIN_VERTICES, GEN_MAX_VERTICES);
+        exit(EXIT_FAILURE);
+    }
+    if (nTargets < GEN_MIN_TARGETS || nTargets >= nVert) {
+        fprintf(stderr, "Need at least %d targets and fewer targets than vertices\n",
+                GEN_MIN_TARGETS);
+        exit(EXIT_FAILURE);
+    }
+    if (boegFraction < 0.0 || boegFraction > 1.0 || spokeLen == 0 ||
+            nSpokes == 0 || nSpokes > GEN_MAX_SPOKES) {
+        fprintf(stderr, "Invalid Boeg fraction or spokes\n");
+        exit(EXIT_FAILURE);
+    }
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Could not create directory '%s'\n", dir);
+        exit(EXIT_FAILURE);
+    }
+
+    set_seed(seed);
+    GenBoard b;
+    b.nVert = nVert;
+    b.pos = (float *) malloc(2 * nVert * sizeof(float));
+    b.nEdge = 0;
+    b.capacity = 4 * nVert;
+    b.edges = (GenEdge *) malloc(b.capacity * sizeof(GenEdge));
+    assert(b.pos && b.edges);
+
+    if (layout == LAYOUT_HUB)
+        gen_hub(&b, spokeLen, nSpokes);
+    else
+        gen_grid(&b, layout == LAYOUT_PLANAR);
+    const unsigned int nBoeg = mark_boeg_edges(&b, boegFraction);
+    unsigned int *label = relabel(nVert, nTargets);
+    write_board(&b, label, nTargets, dir);
+
+    printf("#Vertices: %u, #Edges: %u (%u Boeg-only), #Targets: %u\n",
+           b.nVert, b.nEdge, nBoeg, nTargets);
+    if (nTargets != GEN_DEFAULT_TARGETS)
+        printf("Note: engine needs -DN_TARGETS=%u for this board (others "
+               "refuse to load it)\n", nTargets);
+
+    // Cleanup
+    free(label);
+    free(b.pos);
+    free(b.edges);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,285 @@
+/*
+ * Strategy comparison with sequential early stopping.
+ *
+ * - Head-to-head (default): trials are games won by player 1 or 2,
+ *   success if player 1 won; H0: p = 0.5 vs. H1: p = 0.5 + effect
+ * - Single (-o): trials are all games, success if player 1 won;
+ *   H0: p = 1 / #players vs. H1: p = 1 / #players + effect
+ * - Paired (-p lineup B): every game is played with both lineups from the
+ *   same seed (same placement, targets, turn order & dice); outcome is
+ *   the win of player 1. Trials are games won by player 1 under exactly
+ *   one lineup, success if under lineup A (sign test); H0: p = 0.5 vs.
+ *   H1: p = 0.5 + effect. Reports the paired difference of win rates
+ * - Antithetic (-x, paired only): every seed is also played with mirrored
+ *   dice (DIE_SIZE + 1 - d), the outcome of a seed is the mean of both
+ * - Games are played in batches on a thread pool (game i from seed
+ *   derive_seed(seed, i)); the test is only evaluated at batch
+ *   boundaries, such that the outcome does not depend on the number of
+ *   threads
+ * - With -E, EXPECTIMAX estimates leaves by the endgame tables of the board
+ *   (see endgame_gen) instead of a nearest-neighbor tour
+ * - Stops as soon as the test (SPRT or Bayesian) is decided or after
+ *   the maximum number of games
+ *
+ * Usage: ./compare [-n max. games] [-b batch] [-s seed] [-t threads]
+ *                  [-d effect] [-a alpha] [-e beta] [-m sprt|bayes] [-o]
+ *                  [-p lineup B] [-x] [-E] strategies (e.g. aggg)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>  // getopt
+
+#include "game_state.h"
+#include "thread_pool.h"
+#include "seq_test.h"
+
+#define COMPARE_CHUNK (4)
+
+typedef struct {
+    const BoardInfo_t *binfo;
+    enum MOVE_STRATEGY strategies[MAX_PLAYERS];
+    enum MOVE_STRATEGY strategies_b[MAX_PLAYERS];  // paired lineup
+    AvoidParams_t params[MAX_PLAYERS];
+    unsigned int nPlayers;
+    bool paired, antithetic;
+    uint64_t seed;
+    unsigned long end;        // end of current batch
+    atomic_ulong next;        // next game to be claimed
+    GameState_t *states;      // one game per worker
+    bool *states_valid;
+    SimStats_t *stats;        // one accumulator per worker (lineup A)
+    PairedStats_t *paired_stats;
+} Compare;
+
+// Play game i with given lineup; returns true if player 1 won
+static bool compare_play(Compare *c, GameState_t *gstate, unsigned long i,
+                         const enum MOVE_STRATEGY *strategies, bool antithetic,
+                         SimStats_t *stats)
+{
+    set_seed(derive_seed(c->seed, i));
+    gstate->antithetic = antithetic;
+    GameState_reset(gstate, c->binfo->nPositions);
+    GameResult_t result = GameState_run(c->binfo, gstate, strategies,
+                                        c->params, true, false);
+    if (stats != NULL)
+        SimStats_add(stats, &result, gstate);
+    return result.winner == 0;
+}
+
+static void compare_worker(void *arg, unsigned int worker_id)
+{
+    Compare *c = (Compare *) arg;
+    GameState_t *gstate = &c->states[worker_id];
+    if (!c->states_valid[worker_id]) {
+        GameState_init(gstate, c->nPlayers, c->binfo->nPositions);
+        c->states_valid[worker_id] = true;
+    }
+
+    unsigned long start, i;
+    while ((start = atomic_fetch_add(&c->next, COMPARE_CHUNK)) < c->end) {
+        for (i = start; i < start + COMPARE_CHUNK && i < c->end; ++i) {
+            double a = compare_play(c, gstate, i, c->strategies, false,
+                                    &c->stats[worker_id]);
+            if (!c->paired)
+                continue;
+            double b = compare_play(c, gstate, i, c->strategies_b, false, NULL);
+            if (c->antithetic) {
+                a = 0.5 * (a + compare_play(c, gstate, i, c->strategies, true,
+                                            &c->stats[worker_id]));
+                b = 0.5 * (b + compare_play(c, gstate, i, c->strategies_b,
+                                            true, NULL));
+            }
+            PairedStats_add(&c->paired_stats[worker_id], a, b);
+        }
+    }
+}
+
+static enum MOVE_STRATEGY parse_strategy(char c)
+{
+    switch (c) {
+        case 'a': return AVOIDANT;
+        case 'e': return EXPECTIMAX;
+        case 'g': return GREEDY;
+        case 't': return ENDGAME;
+        default:
+            fprintf(stderr, "Did not recognize strategy: '%c' "
+                    "(MCTS cannot be used in parallel comparisons)\n", c);
+            exit(EXIT_FAILURE);
+    }
+}
+
+int main(int argc, char *argv[]) {
+
+    unsigned long maxGames = 1000000;
+    unsigned long batch = 500;
+    uint64_t seed = 42;
+    unsigned int nThreads = ThreadPool_num_cores();
+    double effect = 0.05, alpha = 0.05, beta = 0.05;
+    enum SEQ_METHOD method = SEQ_SPRT;
+    bool single = false;
+    const char *strategies_b = NULL;
+    bool antithetic = false;
+    bool endgame_leaf = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:b:s:t:d:a:e:m:op:xE")) != -1) {
+        switch (opt) {
+            case 'n': maxGames = strtoul(optarg, NULL, 10); break;
+            case 'b': batch = strtoul(optarg, NULL, 10); break;
+            case 's': seed = strtoull(optarg, NULL, 10); break;
+            case 't': nThreads = atoi(optarg); break;
+            case 'd': effect = atof(optarg); break;
+            case 'a': alpha = atof(optarg); break;
+            case 'e': beta = atof(optarg); break;
+            case 'm': method = optarg[0] == 'b' ? SEQ_BAYES : SEQ_SPRT; break;
+            case 'o': single = true; break;
+            case 'p': strategies_b = optarg; break;
+            case 'x': antithetic = true; break;
+            case 'E': endgame_leaf = true; break;
+            default:
+                fprintf(stderr, "Usage: ./compare [-n max. games] [-b batch] [-s seed] "
+                        "[-t threads] [-d effect] [-a alpha] [-e beta] "
+                        "[-m sprt|bayes] [-o] [-p lineup B] [-x] [-E] strategies\n");
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "Need list of player strategies (e.g. aggg)\n");
+        exit(EXIT_FAILURE);
+    }
+    const char *strategies = argv[optind];
+    const unsigned int nPlayers = strlen(strategies);
+    if (nPlayers < MIN_PLAYERS || nPlayers > MAX_PLAYERS || batch == 0 || nThreads == 0) {
+        fprintf(stderr, "Need %d to %d strategies, at least one game & thread\n",
+                MIN_PLAYERS, MAX_PLAYERS);
+        exit(EXIT_FAILURE);
+    }
+    if (strategies_b != NULL && (strlen(strategies_b) != nPlayers || single)) {
+        fprintf(stderr, "Paired lineup needs %u strategies (and excludes -o)\n",
+                nPlayers);
+        exit(EXIT_FAILURE);
+    }
+    if (antithetic && strategies_b == NULL) {
+        fprintf(stderr, "Antithetic dice need a paired lineup (-p)\n");
+        exit(EXIT_FAILURE);
+    }
+    const double p0 = single ? 1.0 / nPlayers : 0.5;
+    SeqTest_t test;
+    SeqTest_init(&test, method, p0, p0 + effect, alpha, beta);
+
+    BoardInfo_t binfo;
+    BoardInfo_init(&binfo);
+    Compare c;
+    c.binfo = &binfo;
+    c.nPlayers = nPlayers;
+    c.seed = seed;
+    c.paired = strategies_b != NULL;
+    c.antithetic = antithetic;
+    for (unsigned int i = 0; i < nPlayers; ++i) {
+        c.strategies[i] = parse_strategy(strategies[i]);
+        c.strategies_b[i] = c.paired ? parse_strategy(strategies_b[i]) : c.strategies[i];
+        c.params[i] = AVOID_PARAMS_DEFAULT;
+        if ((c.strategies[i] == ENDGAME || c.strategies_b[i] == ENDGAME) &&
+                !Endgame_load(&binfo)) {
+            fprintf(stderr, "Could not load endgame tables (run 'make endgame')\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (endgame_leaf && !Expectimax_use_endgame(&binfo)) {
+        fprintf(stderr, "Could not load endgame tables (run 'make endgame')\n");
+        exit(EXIT_FAILURE);
+    }
+    c.states = (GameState_t *) malloc(nThreads * sizeof(GameState_t));
+    assert(c.states != NULL);
+    c.states_valid = (bool *) calloc(nThreads, sizeof(bool));
+    assert(c.states_valid != NULL);
+    c.stats = (SimStats_t *) malloc(nThreads * sizeof(SimStats_t));
+    assert(c.stats != NULL);
+    SimStats_t *merged = (SimStats_t *) malloc(nThreads * sizeof(SimStats_t));
+    assert(merged != NULL);
+    c.paired_stats = (PairedStats_t *) malloc(nThreads * sizeof(PairedStats_t));
+    assert(c.paired_stats != NULL);
+    PairedStats_t *paired_merged = (PairedStats_t *) malloc(nThreads * sizeof(PairedStats_t));
+    assert(paired_merged != NULL);
+    for (unsigned int i = 0; i < nThreads; ++i) {
+        SimStats_init(&c.stats[i], nPlayers);
+        PairedStats_init(&c.paired_stats[i]);
+    }
+    atomic_init(&c.next, 0);
+    c.end = 0;
+
+    ThreadPool pool;
+    ThreadPool_init(&pool, nThreads);
+    printf("# %s test, H0: p = %.4f, H1: p = %.4f, alpha = %.3f, beta = %.3f, "
+           "EXPECTIMAX leaf: %s\n", method == SEQ_SPRT ? "SPRT" : "Bayesian",
+           test.p0, test.p1, alpha, beta, endgame_leaf ? "endgame tables" : "tour");
+    if (c.paired)
+        printf("games,rate_a,rate_b,diff,diff_ci,trials,successes,statistic\n");
+    else
+        printf("games,wins_1,wins_2,trials,successes,statistic\n");
+
+    enum SEQ_DECISION decision = SEQ_CONTINUE;
+    SimStats_t *total = &merged[0];
+    while (decision == SEQ_CONTINUE && c.end < maxGames) {
+        // Claims beyond the previous batch were not played
+        atomic_store(&c.next, c.end);
+        c.end = c.end + batch < maxGames ? c.end + batch : maxGames;
+        ThreadPool_run(&pool, compare_worker, &c);
+        // Combine accumulators of all workers
+        memcpy(merged, c.stats, nThreads * sizeof(SimStats_t));
+        SimStats_reduce(merged, nThreads);
+
+        const unsigned long wins1 = total->seat_wins[0], wins2 = total->seat_wins[1];
+        test.n = 0;
+        test.k = 0;
+        if (c.paired) {
+            memcpy(paired_merged, c.paired_stats, nThreads * sizeof(PairedStats_t));
+            PairedStats_reduce(paired_merged, nThreads);
+            const PairedStats_t *ps = &paired_merged[0];
+            SeqTest_add(&test, ps->nBetter, ps->nBetter + ps->nWorse);
+            decision = SeqTest_decide(&test);
+            printf("%lu,%.4f,%.4f,%.4f,%.4f,%lu,%lu,%.4f\n", ps->diff.n,
+                   ps->a.mean, ps->b.mean, ps->diff.mean, PairedStats_ci(ps),
+                   test.n, test.k, SeqTest_statistic(&test));
+        } else {
+            if (single)
+                SeqTest_add(&test, wins1, total->nGames);
+            else
+                SeqTest_add(&test, wins1, wins1 + wins2);
+            decision = SeqTest_decide(&test);
+            printf("%lu,%lu,%lu,%lu,%lu,%.4f\n", total->nGames, wins1, wins2,
+                   test.n, test.k, SeqTest_statistic(&test));
+        }
+        fflush(stdout);
+    }
+    const char *verdict = decision == SEQ_ACCEPT_H1 ? "is stronger than" :
+            decision == SEQ_ACCEPT_H0 ? "is not stronger than" : "vs.";
+    if (c.paired) {
+        printf("# %s after %lu seeds: player 1 with lineup %s %s with lineup %s\n",
+               SEQ_DECISION_NAMES[decision], paired_merged[0].diff.n,
+               strategies, verdict, strategies_b);
+        PairedStats_print(&paired_merged[0]);
+    } else {
+        printf("# %s after %lu games: player 1 (%s) %s player %s\n",
+               SEQ_DECISION_NAMES[decision], total->nGames,
+               STRATEGY_NAMES[c.strategies[0]], verdict,
+               single ? "average" : "2");
+    }
+
+    // Cleanup
+    ThreadPool_free(&pool);
+    for (unsigned int i = 0; i < nThreads; ++i) {
+        if (c.states_valid[i])
+            GameState_free(&c.states[i]);
+    }
+    free(c.states);
+    free(c.states_valid);
+    free(c.stats);
+    free(merged);
+    free(c.paired_stats);
+    free(paired_merged);
+    BoardInfo_free(&binfo);
+    return 0;
+}
@@ -0,0 +1,56 @@
+/*
+ * Offline generator of the endgame tables (movement of players and Boeg)
+ * used by the ENDGAME strategy and as leaf estimate of EXPECTIMAX.
+ * Tables are written into the directory of the board (see Endgame_load).
+ *
+ * Usage: ./endgame_gen [num_threads (default: number of cores)] [board_dir]
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "game_state.h"
+#include "thread_pool.h"
+
+static double elapsed_s(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) * 1e-9;
+}
+
+int main(int argc, char *argv[]) {
+
+    unsigned int nThreads = argc > 1 ? (unsigned int) atoi(argv[1]) :
+                                       ThreadPool_num_cores();
+    const char *board_dir = argc > 2 ? argv[2] : BOARD_DIR;
+    if (nThreads == 0) {
+        fprintf(stderr, "Usage: ./endgame_gen [num_threads] [board_dir]\n");
+        exit(EXIT_FAILURE);
+    }
+
+    BoardInfo_t binfo;
+    BoardInfo_init_dir(&binfo, board_dir);
+    ThreadPool pool;
+    ThreadPool_init(&pool, nThreads);
+    printf("#Positions: %u, #Threads: %u\n", binfo.nPositions, nThreads);
+
+    char path[4096];
+    for (int isBoeg = 0; isBoeg <= 1; ++isBoeg) {
+        EndgameTable et;
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        EndgameTable_build(&et, &binfo, isBoeg, &pool);
+        Endgame_path(&binfo, isBoeg, path, sizeof(path));
+        EndgameTable_save(&et, path);
+        printf("Wrote '%s' (%zu subsets) in %.2fs\n", path,
+               et.offsets[ENDGAME_MAX_TARGETS + 1], elapsed_s(&start));
+        EndgameTable_free(&et);
+    }
+
+    ThreadPool_free(&pool);
+    BoardInfo_free(&binfo);
+    return 0;
+}
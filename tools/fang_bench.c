@@ -0,0 +1,416 @@
+/*
+ * Microbenchmarks of core kernels.
+ *
+ * - Graph kernels (on board/graph.txt and the fixtures in graphs/):
+ *   Graph_init_file, Graph_BFS_APSP (player & Boeg), Graph_reachable_pos
+ *   for every start vertex and dice value, Graph_is_reachable for all pairs
+ *   of vertices at distance DIE_SIZE
+ * - HashMap_insert & HashMap_find (half of the lookups miss)
+ * - One move of every strategy (GameState_move on fixed sample states of
+ *   the board, including GameState_copy of the sample); every EXPECTIMAX
+ *   move is a cold search, as each search keys its transposition table
+ *   entries on a new generation (see expectimax.h)
+ * - Every benchmark is calibrated such that one repetition takes at least
+ *   BENCH_REP_NS, followed by warm-up and timed repetitions; reported are
+ *   mean & percentiles of the time per operation over all repetitions
+ * - With -o, results are also written as JSON
+ * - With -b, strategies move on another board (e.g. written by board_gen)
+ *
+ * Usage: ./fang_bench [-r reps] [-w warm-up reps] [-f filter] [-o json]
+ *                     [-b board_dir] [graph files]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>    // clock_gettime
+#include <unistd.h>  // getopt
+
+#include "game_state.h"
+
+// Minimum duration of one repetition in nanoseconds
+#ifndef BENCH_REP_NS
+#define BENCH_REP_NS (2000000.0)
+#endif
+// Number of sample states per strategy benchmark
+#define BENCH_SAMPLES (64)
+#define BENCH_HASH_KEYS (128)
+#define BENCH_MAX_RESULTS (128)
+#define BENCH_NAME_SIZE (128)
+
+static const char *DEFAULT_GRAPHS[] = {
+    "board/graph.txt",
+    "graphs/graph_larger.txt",
+    "graphs/graph_simple.txt",
+    "graphs/graph_test.txt"
+};
+
+// Inputs of all kernels
+typedef struct {
+    const char *path;
+    Graph graph;
+    int *dist;
+    int *par;
+    bool *visited_buf;
+    int *distances_buf;
+    HashMap map;
+    unsigned int keys[2 * BENCH_HASH_KEYS];
+    const BoardInfo_t *binfo;
+    GameState_t samples[BENCH_SAMPLES];
+    unsigned int sample_pid[BENCH_SAMPLES];
+    uint64_t sample_dice[BENCH_SAMPLES];
+    GameState_t work;
+    enum MOVE_STRATEGY strat;
+    unsigned long next;  // next sample state
+} BenchCtx;
+
+typedef struct {
+    char name[BENCH_NAME_SIZE];
+    const char *input;
+    unsigned long inner;  // operations per repetition
+    unsigned int reps;
+    double mean, min, p50, p90, p99, max;  // ns per operation
+} BenchResult;
+
+typedef void (*BenchFn)(BenchCtx *);
+
+static volatile unsigned long _sink = 0;  // keeps results alive
+
+static double now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// -- Kernels (one operation each) --
+
+static void bench_init_file(BenchCtx *c)
+{
+    FILE *fp = fopen(c->path, "r");
+    assert(fp != NULL);
+    Graph graph;
+    Graph_init_file(&graph, fp);
+    fclose(fp);
+    _sink += graph.nEdge;
+    Graph_free(&graph);
+}
+
+static void bench_apsp_player(BenchCtx *c)
+{
+    Graph_BFS_APSP(&c->graph, false, c->dist, c->par);
+    _sink += c->dist[c->graph.nVert - 1];
+}
+
+static void bench_apsp_boeg(BenchCtx *c)
+{
+    Graph_BFS_APSP(&c->graph, true, c->dist, c->par);
+    _sink += c->dist[c->graph.nVert - 1];
+}
+
+static void _bench_reachable_pos(BenchCtx *c, bool isBoeg)
+{
+    for (unsigned int source = 0; source < c->graph.nVert; ++source) {
+        for (int d = 1; d <= DIE_SIZE; ++d) {
+            HashMap reachable = Graph_reachable_pos(&c->graph, isBoeg, source, d,
+                                                    c->visited_buf, c->distances_buf);
+            _sink += HashMap_size(&reachable);
+        }
+    }
+}
+
+static void bench_reachable_player(BenchCtx *c) { _bench_reachable_pos(c, false); }
+static void bench_reachable_boeg(BenchCtx *c) { _bench_reachable_pos(c, true); }
+
+static void bench_is_reachable(BenchCtx *c)
+{
+    for (unsigned int source = 0; source < c->graph.nVert; ++source) {
+        for (unsigned int target = 0; target < c->graph.nVert; ++target) {
+            _sink += Graph_is_reachable(&c->graph, false, source, target, DIE_SIZE,
+                                        c->visited_buf, c->distances_buf);
+        }
+    }
+}
+
+static void bench_hash_insert(BenchCtx *c)
+{
+    HashMap_init(&c->map);
+    for (unsigned int i = 0; i < BENCH_HASH_KEYS; ++i)
+        HashMap_insert(&c->map, c->keys[i]);
+    _sink += HashMap_size(&c->map);
+}
+
+static void bench_hash_find(BenchCtx *c)
+{
+    for (unsigned int i = 0; i < 2 * BENCH_HASH_KEYS; ++i)
+        _sink += HashMap_find(&c->map, c->keys[i]);
+}
+
+static void bench_move(BenchCtx *c)
+{
+    const unsigned long k = c->next++ % BENCH_SAMPLES;
+    GameState_copy(&c->work, &c->samples[k]);
+    c->work.dice_state = c->sample_dice[k];
+    const unsigned int pid = c->sample_pid[k];
+    _sink += GameState_move(c->binfo, &c->work, pid, &AVOID_PARAMS_DEFAULT,
+                            c->strat, false);
+}
+
+// -- Runner --
+
+static int cmp_double(const void *a, const void *b)
+{
+    const double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, unsigned int n, double p)
+{
+    unsigned int rank = (unsigned int)(p * n + 0.5);  // nearest rank
+    rank = rank < 1 ? 1 : (rank > n ? n : rank);
+    return sorted[rank - 1];
+}
+
+static double time_rep(BenchFn fn, BenchCtx *c, unsigned long inner)
+{
+    const double start = now_ns();
+    for (unsigned long i = 0; i < inner; ++i)
+        fn(c);
+    return now_ns() - start;
+}
+
+static BenchResult run(const char *name, const char *input, BenchFn fn,
+                       BenchCtx *c, unsigned int warmup, unsigned int reps)
+{
+    BenchResult res;
+    snprintf(res.name, sizeof(res.name), "%s", name);
+    res.input = input;
+    res.reps = reps;
+
+    // Calibrate number of operations per repetition
+    unsigned long inner = 1;
+    while (time_rep(fn, c, inner) < BENCH_REP_NS && inner < (1UL << 30))
+        inner *= 2;
+    res.inner = inner;
+
+    for (unsigned int r = 0; r < warmup; ++r)
+        time_rep(fn, c, inner);
+    double *ns = (double *) malloc(reps * sizeof(double));
+    assert(ns != NULL);
+    double sum = 0.0;
+    for (unsigned int r = 0; r < reps; ++r) {
+        ns[r] = time_rep(fn, c, inner) / inner;
+        sum += ns[r];
+    }
+    qsort(ns, reps, sizeof(double), cmp_double);
+    res.mean = sum / reps;
+    res.min = ns[0];
+    res.p50 = percentile(ns, reps, 0.50);
+    res.p90 = percentile(ns, reps, 0.90);
+    res.p99 = percentile(ns, reps, 0.99);
+    res.max = ns[reps - 1];
+    free(ns);
+
+    printf("%-24s %-26s %12.1f %12.1f %12.1f %12.1f %10lu\n", res.name,
+           res.input, res.min, res.p50, res.p90, res.max, res.inner);
+    fflush(stdout);
+    return res;
+}
+
+static void write_json(const char *path, const BenchResult *results,
+                       unsigned int nResults, unsigned int warmup)
+{
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        fprintf(stderr, "Could not open '%s'\n", path);
+        exit(EXIT_FAILURE);
+    }
+    fprintf(fp, "{\n  \"unit\": \"ns/op\",\n  \"warmup\": %u,\n  \"results\": [\n",
+            warmup);
+    for (unsigned int i = 0; i < nResults; ++i) {
+        const BenchResult *r = &results[i];
+        fprintf(fp, "    {\"name\": \"%s\", \"input\": \"%s\", \"reps\": %u, "
+                "\"ops_per_rep\": %lu, \"mean\": %.3f, \"min\": %.3f, "
+                "\"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f}%s\n",
+                r->name, r->input, r->reps, r->inner, r->mean, r->min, r->p50,
+                r->p90, r->p99, r->max, i + 1 < nResults ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+    fclose(fp);
+}
+
+static bool selected(const char *filter, const char *name)
+{
+    return filter == NULL || strstr(name, filter) != NULL;
+}
+
+// Mid-game states of the board (player to move & its dice stream)
+static void init_samples(BenchCtx *c, const BoardInfo_t *binfo)
+{
+    const enum MOVE_STRATEGY greedy[MAX_PLAYERS] = {GREEDY, GREEDY, GREEDY, GREEDY,
+                                                    GREEDY, GREEDY};
+    AvoidParams_t params[MAX_PLAYERS];
+    for (unsigned int p = 0; p < MAX_PLAYERS; ++p)
+        params[p] = AVOID_PARAMS_DEFAULT;
+
+    for (unsigned int k = 0; k < BENCH_SAMPLES; ++k) {
+        GameState_t *gstate = &c->samples[k];
+        GameState_init(gstate, 4, binfo->nPositions);
+        set_seed(derive_seed(42, k));
+        GameState_reset(gstate, binfo->nPositions);
+        GameStepper_t stepper;
+        GameStepper_init(&stepper, gstate, true);
+        // Play a varying number of greedy moves into the game
+        for (unsigned int m = 0; m < k % 40 && !stepper.done; ++m)
+            GameStepper_step(binfo, &stepper, gstate, greedy, params, false);
+        if (stepper.done) {
+            GameState_reset(gstate, binfo->nPositions);
+            GameStepper_init(&stepper, gstate, true);
+        }
+        c->sample_pid[k] = GameStepper_player(&stepper, gstate);
+        c->sample_dice[k] = next();
+    }
+    GameState_init(&c->work, 4, binfo->nPositions);
+}
+
+int main(int argc, char *argv[]) {
+
+    unsigned int reps = 15;
+    unsigned int warmup = 3;
+    const char *filter = NULL;
+    const char *json_path = NULL;
+    const char *board_dir = BOARD_DIR;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "r:w:f:o:b:")) != -1) {
+        switch (opt) {
+            case 'r': reps = atoi(optarg); break;
+            case 'w': warmup = atoi(optarg); break;
+            case 'f': filter = optarg; break;
+            case 'o': json_path = optarg; break;
+            case 'b': board_dir = optarg; break;
+            default:
+                fprintf(stderr, "Usage: ./fang_bench [-r reps] [-w warm-up reps] "
+                        "[-f filter] [-o json] [-b board_dir] [graph files]\n");
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (reps == 0) {
+        fprintf(stderr, "Need at least 1 repetition\n");
+        exit(EXIT_FAILURE);
+    }
+    const char **graphs = DEFAULT_GRAPHS;
+    unsigned int nGraphs = sizeof(DEFAULT_GRAPHS) / sizeof(DEFAULT_GRAPHS[0]);
+    if (optind < argc) {
+        graphs = (const char **) &argv[optind];
+        nGraphs = argc - optind;
+    }
+
+    static BenchCtx c;
+    static BenchResult results[BENCH_MAX_RESULTS];
+    unsigned int nResults = 0;
+    printf("%-24s %-26s %12s %12s %12s %12s %10s\n", "benchmark", "input",
+           "min ns/op", "p50 ns/op", "p90 ns/op", "max ns/op", "ops/rep");
+
+    // Graph kernels
+    static const struct {
+        const char *name;
+        BenchFn fn;
+    } GRAPH_BENCHES[] = {
+        {"graph_init_file", bench_init_file},
+        {"bfs_apsp_player", bench_apsp_player},
+        {"bfs_apsp_boeg", bench_apsp_boeg},
+        {"reachable_pos_player", bench_reachable_player},
+        {"reachable_pos_boeg", bench_reachable_boeg},
+        {"is_reachable", bench_is_reachable}
+    };
+    for (unsigned int g = 0; g < nGraphs; ++g) {
+        c.path = graphs[g];
+        FILE *fp = fopen(c.path, "r");
+        if (fp == NULL) {
+            fprintf(stderr, "Could not open graph '%s'\n", c.path);
+            exit(EXIT_FAILURE);
+        }
+        Graph_init_file(&c.graph, fp);
+        fclose(fp);
+        const unsigned int n = c.graph.nVert;
+        c.dist = (int *) malloc(n * n * sizeof(int));
+        c.par = (int *) malloc(n * n * sizeof(int));
+        c.visited_buf = (bool *) malloc(n * sizeof(bool));
+        c.distances_buf = (int *) malloc(n * sizeof(int));
+        assert(c.dist && c.par && c.visited_buf && c.distances_buf);
+
+        for (unsigned int b = 0; b < sizeof(GRAPH_BENCHES) / sizeof(GRAPH_BENCHES[0]); ++b) {
+            if (selected(filter, GRAPH_BENCHES[b].name) && nResults < BENCH_MAX_RESULTS) {
+                results[nResults++] = run(GRAPH_BENCHES[b].name, c.path,
+                                          GRAPH_BENCHES[b].fn, &c, warmup, reps);
+            }
+        }
+        free(c.dist);
+        free(c.par);
+        free(c.visited_buf);
+        free(c.distances_buf);
+        Graph_free(&c.graph);
+    }
+
+    // Hash map: first half of keys is inserted, second half misses
+    set_seed(42);
+    for (unsigned int i = 0; i < 2 * BENCH_HASH_KEYS; ++i)
+        c.keys[i] = (unsigned int)(next() % 1000000);
+    if (selected(filter, "hashmap_insert"))
+        results[nResults++] = run("hashmap_insert", "128 keys", bench_hash_insert,
+                                  &c, warmup, reps);
+    bench_hash_insert(&c);
+    if (selected(filter, "hashmap_find"))
+        results[nResults++] = run("hashmap_find", "256 keys", bench_hash_find,
+                                  &c, warmup, reps);
+
+    // Strategies on the board
+    static const struct {
+        const char *name;
+        enum MOVE_STRATEGY strat;
+    } MOVE_BENCHES[] = {
+        {"move_greedy", GREEDY},
+        {"move_avoidant", AVOIDANT},
+        {"move_expectimax", EXPECTIMAX},
+        {"move_mcts", MCTS},
+        {"move_endgame", ENDGAME}
+    };
+    bool anyMove = false;
+    for (unsigned int b = 0; b < sizeof(MOVE_BENCHES) / sizeof(MOVE_BENCHES[0]); ++b)
+        anyMove = anyMove || selected(filter, MOVE_BENCHES[b].name);
+    if (anyMove) {
+        BoardInfo_t binfo;
+        BoardInfo_init_dir(&binfo, board_dir);
+        // Only ENDGAME reads the tables, EXPECTIMAX keeps its tour leaf
+        const bool hasEndgame = Endgame_load(&binfo);
+        MCTS_configure(&binfo, MCTS_ROLLOUTS, 1, GREEDY);
+        c.binfo = &binfo;
+        init_samples(&c, &binfo);
+
+        for (unsigned int b = 0; b < sizeof(MOVE_BENCHES) / sizeof(MOVE_BENCHES[0]); ++b) {
+            if (!selected(filter, MOVE_BENCHES[b].name))
+                continue;
+            if (MOVE_BENCHES[b].strat == ENDGAME && !hasEndgame) {
+                fprintf(stderr, "Skipping %s (run 'make endgame')\n",
+                        MOVE_BENCHES[b].name);
+                continue;
+            }
+            c.strat = MOVE_BENCHES[b].strat;
+            c.next = 0;
+            results[nResults++] = run(MOVE_BENCHES[b].name, board_dir,
+                                      bench_move, &c, warmup, reps);
+        }
+
+        // Cleanup
+        for (unsigned int k = 0; k < BENCH_SAMPLES; ++k)
+            GameState_free(&c.samples[k]);
+        GameState_free(&c.work);
+        BoardInfo_free(&binfo);
+    }
+
+    if (json_path != NULL)
+        write_json(json_path, results, nResults, warmup);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,137 @@
+/*
+ * Headless statistics campaign (see GameState_simulate) with checkpoints.
+ *
+ * - Game i is played from derive_seed(seed, i) on a thread pool; the
+ *   report is bit-identical for any number of threads
+ * - With -c, a checkpoint is written in the background every -i games;
+ *   -r resumes from it and continues the exact same sequence of games,
+ *   such that the final statistics equal those of an uninterrupted run
+ *   (the seed of the checkpoint is used unless -s is given, in which case
+ *   both must agree; -n must not be below the games already played)
+ * - With -b, games are played on another board (e.g. written by board_gen)
+ * - With -l, the latency of moves is measured and summarized by strategy,
+ *   role and code path (see move_timing.h)
+ * - With -p, hardware performance counters are reported per region and per
+ *   game (see perf_counters.h); games are then played on one thread
+ * - With -E, EXPECTIMAX estimates leaves by the endgame tables of the board
+ *   (see endgame_gen) instead of a nearest-neighbor tour
+ * - With FANG_TRACE=file in the environment, a timeline of board
+ *   initialization and simulation rounds (and of turns, unless the lockstep
+ *   engine plays the games) is written to file (see trace.h)
+ *
+ * Usage: ./stats [-n games] [-s seed] [-t threads] [-c checkpoint]
+ *                [-i interval] [-r] [-b board_dir] [-l] [-p] [-E]
+ *                strategies (e.g. aggg)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>  // getopt
+
+#include "game_state.h"
+
+static enum MOVE_STRATEGY parse_strategy(char c)
+{
+    switch (c) {
+        case 'a': return AVOIDANT;
+        case 'e': return EXPECTIMAX;
+        case 'g': return GREEDY;
+        case 'm': return MCTS;
+        case 't': return ENDGAME;
+        default:
+            fprintf(stderr, "Did not recognize strategy: '%c'\n", c);
+            exit(EXIT_FAILURE);
+    }
+}
+
+int main(int argc, char *argv[]) {
+
+    unsigned long nGames = 10000;
+    const char *board_dir = BOARD_DIR;
+    bool timed = false;
+    bool profiled = false;
+    bool endgame_leaf = false;
+    bool seeded = false;
+    SimOptions_t opts = {.seed = 42, .nThreads = 0, .ckpt_path = NULL,
+                         .ckpt_interval = 100000, .resume = false,
+                         .timing = NULL};
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:t:c:i:rb:lpE")) != -1) {
+        switch (opt) {
+            case 'n': nGames = strtoul(optarg, NULL, 10); break;
+            case 's': opts.seed = strtoull(optarg, NULL, 10); seeded = true; break;
+            case 't': opts.nThreads = atoi(optarg); break;
+            case 'c': opts.ckpt_path = optarg; break;
+            case 'i': opts.ckpt_interval = strtoul(optarg, NULL, 10); break;
+            case 'r': opts.resume = true; break;
+            case 'b': board_dir = optarg; break;
+            case 'l': timed = true; break;
+            case 'p': profiled = true; break;
+            case 'E': endgame_leaf = true; break;
+            default:
+                fprintf(stderr, "Usage: ./stats [-n games] [-s seed] [-t threads] "
+                        "[-c checkpoint] [-i interval] [-r] [-b board_dir] [-l] [-p] [-E] "
+                        "strategies\n");
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "Need list of player strategies (e.g. aggg)\n");
+        exit(EXIT_FAILURE);
+    }
+    const char *strategies = argv[optind];
+    const unsigned int nPlayers = strlen(strategies);
+    if (nPlayers < MIN_PLAYERS || nPlayers > MAX_PLAYERS) {
+        fprintf(stderr, "Need %d to %d strategies\n", MIN_PLAYERS, MAX_PLAYERS);
+        exit(EXIT_FAILURE);
+    }
+    if (opts.resume && opts.ckpt_path == NULL) {
+        fprintf(stderr, "Resuming needs a checkpoint (-c)\n");
+        exit(EXIT_FAILURE);
+    }
+    // Continue with seed of checkpoint, unless given explicitly
+    Checkpoint_t ckpt;
+    if (opts.resume && !seeded && Checkpoint_load(&ckpt, opts.ckpt_path))
+        opts.seed = ckpt.seed;
+    enum MOVE_STRATEGY player_strategies[MAX_PLAYERS];
+    for (unsigned int i = 0; i < nPlayers; ++i)
+        player_strategies[i] = parse_strategy(strategies[i]);
+
+    Trace_init();
+    if (profiled && !Perf_init())
+        fprintf(stderr, "Continuing without performance counters\n");
+    BoardInfo_t binfo;
+    BoardInfo_init_dir(&binfo, board_dir);
+    for (unsigned int i = 0; i < nPlayers; ++i) {
+        if (player_strategies[i] == ENDGAME && !Endgame_load(&binfo)) {
+            fprintf(stderr, "Could not load endgame tables (run 'make endgame')\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (endgame_leaf && !Expectimax_use_endgame(&binfo)) {
+        fprintf(stderr, "Could not load endgame tables (run 'make endgame')\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (timed) {
+        opts.timing = (MoveTiming_t *) malloc(sizeof(MoveTiming_t));
+        assert(opts.timing != NULL);
+    }
+    SimStats_t stats;
+    const int status = GameState_simulate(&binfo, nPlayers, player_strategies,
+                                          nGames, &opts, &stats);
+    if (status == 0)
+        SimStats_print(&stats, player_strategies);
+    if (status == 0 && timed)
+        MoveTiming_print(opts.timing);
+    if (status == 0)
+        Perf_print();
+
+    // Cleanup
+    Perf_free();
+    free(opts.timing);
+    BoardInfo_free(&binfo);
+    return status == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,319 @@
+/*
+ * Parameter sweep over the avoidance objective (base avoidance & factor
+ * by which the penalty of far away opponents is lessened).
+ *
+ * - Player 1 uses the swept parameters, all other players the defaults;
+ *   player 1 must be AVOIDANT or EXPECTIMAX (the strategies using them)
+ * - Every setting is evaluated on the same games: game i is played from
+ *   seed derive_seed(seed, i) (common random numbers), such that results
+ *   do not depend on the number of threads and differences between
+ *   settings are not drowned by the luck of the dice
+ * - Strategies must not carry state from one game to the next (games of
+ *   a worker share its game state): EXPECTIMAX keys its transposition
+ *   table on the parameters and starts every search afresh, such that a
+ *   setting does not depend on the settings evaluated before it
+ * - Games are distributed among the workers of a thread pool (MCTS is
+ *   not supported, as it runs its own thread pool per move)
+ * - Grid search, optionally refined by zooming in around the best
+ *   setting for a number of rounds (adaptive search)
+ * - With -E, EXPECTIMAX estimates leaves by the endgame tables of the board
+ *   (see endgame_gen) instead of a nearest-neighbor tour
+ * - Output (CSV): win rate of player 1 with 95% Wilson interval and the
+ *   paired difference to the default parameters with 95% interval
+ *
+ * Usage: ./sweep [-n games] [-s seed] [-t threads] [-p strategies]
+ *                [-b lo:hi:step] [-f lo:hi:step] [-r rounds] [-E]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>  // getopt
+#include <math.h>
+
+#include "game_state.h"
+#include "thread_pool.h"
+
+#define SWEEP_CHUNK (8)
+#define SWEEP_Z (1.96)  // 95% confidence
+
+typedef struct {
+    double lo, hi, step;
+} Range;
+
+typedef struct {
+    const BoardInfo_t *binfo;
+    enum MOVE_STRATEGY strategies[MAX_PLAYERS];
+    AvoidParams_t params[MAX_PLAYERS];
+    unsigned int nPlayers;
+    uint64_t seed;
+    unsigned int nGames;
+    atomic_uint next;         // next game to be claimed
+    unsigned char *outcome;   // 1 if player 1 won game i
+    GameState_t *states;      // one game per worker
+    bool *states_valid;
+} Sweep;
+
+static void sweep_worker(void *arg, unsigned int worker_id)
+{
+    Sweep *sw = (Sweep *) arg;
+    GameState_t *gstate = &sw->states[worker_id];
+    if (!sw->states_valid[worker_id]) {
+        GameState_init(gstate, sw->nPlayers, sw->binfo->nPositions);
+        sw->states_valid[worker_id] = true;
+    }
+
+    unsigned int start, i;
+    while ((start = atomic_fetch_add(&sw->next, SWEEP_CHUNK)) < sw->nGames) {
+        for (i = start; i < start + SWEEP_CHUNK && i < sw->nGames; ++i) {
+            // Game only depends on its seed
+            set_seed(derive_seed(sw->seed, i));
+            GameState_reset(gstate, sw->binfo->nPositions);
+            GameResult_t result = GameState_run(sw->binfo, gstate, sw->strategies,
+                                                sw->params, true, false);
+            sw->outcome[i] = result.winner == 0;
+        }
+    }
+}
+
+// Play all games with given parameters of player 1; returns #wins
+static unsigned int sweep_eval(Sweep *sw, ThreadPool *pool,
+                               const AvoidParams_t *params)
+{
+    sw->params[0] = *params;
+    atomic_store(&sw->next, 0);
+    ThreadPool_run(pool, sweep_worker, sw);
+
+    unsigned int wins = 0;
+    for (unsigned int i = 0; i < sw->nGames; ++i)
+        wins += sw->outcome[i];
+    return wins;
+}
+
+// Parse "lo:hi:step" or single value; all values must be at least min
+// (or exceed it, if positive)
+static Range parse_range(const char *arg, double min, bool positive)
+{
+    Range r;
+    int n = sscanf(arg, "%lf:%lf:%lf", &r.lo, &r.hi, &r.step);
+    if (n == 1) {
+        r.hi = r.lo;
+        r.step = 1.0;
+    } else if (n != 3 || r.step <= 0.0 || r.hi < r.lo) {
+        fprintf(stderr, "Invalid range '%s' (expected lo:hi:step)\n", arg);
+        exit(EXIT_FAILURE);
+    }
+    if (r.lo < min || (positive && r.lo <= min)) {
+        fprintf(stderr, "Invalid range '%s' (values must be %s %g)\n", arg,
+                positive ? ">" : ">=", min);
+        exit(EXIT_FAILURE);
+    }
+    return r;
+}
+
+static unsigned int range_size(const Range *r)
+{
+    return (unsigned int)floor((r->hi - r->lo) / r->step + 1e-9) + 1;
+}
+
+// Shrink range around value by half, keeping the number of points; the
+// range starts at min at the earliest
+static Range range_zoom(const Range *r, double value, double min)
+{
+    Range z;
+    const unsigned int n = range_size(r);
+    z.step = r->step / 2.0;
+    if (n == 1) {
+        z.lo = z.hi = value;
+        return z;
+    }
+    z.lo = value - z.step * (n / 2);
+    if (z.lo < min)
+        z.lo = min;
+    z.hi = z.lo + z.step * (n - 1);
+    return z;
+}
+
+// Wilson score interval of win rate
+static void wilson(unsigned int wins, unsigned int n, double *lo, double *hi)
+{
+    const double p = (double)wins / n;
+    const double z2 = SWEEP_Z * SWEEP_Z;
+    const double center = (p + z2 / (2.0 * n)) / (1.0 + z2 / n);
+    const double half = SWEEP_Z * sqrt(p * (1.0 - p) / n + z2 / (4.0 * n * n)) /
+            (1.0 + z2 / n);
+    *lo = center - half;
+    *hi = center + half;
+}
+
+// Mean & half width of interval of paired difference to baseline
+static void paired_diff(const unsigned char *outcome,
+                        const unsigned char *baseline, unsigned int n,
+                        double *mean, double *half)
+{
+    double sum = 0.0, sum_sq = 0.0;
+    for (unsigned int i = 0; i < n; ++i) {
+        const double d = (double)outcome[i] - baseline[i];
+        sum += d;
+        sum_sq += d * d;
+    }
+    *mean = sum / n;
+    const double var = n > 1 ? (sum_sq - n * (*mean) * (*mean)) / (n - 1) : 0.0;
+    *half = SWEEP_Z * sqrt(var / n);
+}
+
+static enum MOVE_STRATEGY parse_strategy(char c)
+{
+    switch (c) {
+        case 'a': return AVOIDANT;
+        case 'e': return EXPECTIMAX;
+        case 'g': return GREEDY;
+        case 't': return ENDGAME;
+        default:
+            fprintf(stderr, "Did not recognize strategy: '%c'\n", c);
+            exit(EXIT_FAILURE);
+    }
+}
+
+int main(int argc, char *argv[]) {
+
+    unsigned int nGames = 2000;
+    uint64_t seed = 42;
+    unsigned int nThreads = ThreadPool_num_cores();
+    const char *strategies = "aaaa";
+    Range base = {10.0, 80.0, 10.0};
+    Range far = {FAR_FACTOR_DEFAULT, FAR_FACTOR_DEFAULT, 1.0};
+    unsigned int rounds = 0;
+    bool endgame_leaf = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:t:p:b:f:r:E")) != -1) {
+        switch (opt) {
+            case 'n': nGames = atoi(optarg); break;
+            case 's': seed = strtoull(optarg, NULL, 10); break;
+            case 't': nThreads = atoi(optarg); break;
+            case 'p': strategies = optarg; break;
+            case 'b': base = parse_range(optarg, 0.0, false); break;
+            // Far factor divides the penalty
+            case 'f': far = parse_range(optarg, 0.0, true); break;
+            case 'r': rounds = atoi(optarg); break;
+            case 'E': endgame_leaf = true; break;
+            default:
+                fprintf(stderr, "Usage: ./sweep [-n games] [-s seed] [-t threads] "
+                        "[-p strategies] [-b lo:hi:step] [-f lo:hi:step] [-r rounds] [-E]\n");
+                exit(EXIT_FAILURE);
+        }
+    }
+    const unsigned int nPlayers = strlen(strategies);
+    if (nPlayers < MIN_PLAYERS || nPlayers > MAX_PLAYERS || nGames == 0 || nThreads == 0) {
+        fprintf(stderr, "Need %d to %d strategies, at least one game & thread\n",
+                MIN_PLAYERS, MAX_PLAYERS);
+        exit(EXIT_FAILURE);
+    }
+
+    // Only player 1 uses the swept parameters
+    const enum MOVE_STRATEGY swept = parse_strategy(strategies[0]);
+    if (swept != AVOIDANT && swept != EXPECTIMAX) {
+        fprintf(stderr, "Player 1 must use the avoidance objective (a or e), "
+                "'%c' ignores the swept parameters\n", strategies[0]);
+        fprintf(stderr, "Usage: ./sweep [-n games] [-s seed] [-t threads] "
+                "[-p strategies] [-b lo:hi:step] [-f lo:hi:step] [-r rounds] [-E]\n");
+        exit(EXIT_FAILURE);
+    }
+
+    BoardInfo_t binfo;
+    BoardInfo_init(&binfo);
+    for (unsigned int i = 0; i < nPlayers; ++i) {
+        if (strategies[i] == 't' && !Endgame_load(&binfo)) {
+            fprintf(stderr, "Could not load endgame tables (run 'make endgame')\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (endgame_leaf && !Expectimax_use_endgame(&binfo)) {
+        fprintf(stderr, "Could not load endgame tables (run 'make endgame')\n");
+        exit(EXIT_FAILURE);
+    }
+    ThreadPool pool;
+    ThreadPool_init(&pool, nThreads);
+
+    Sweep sw;
+    sw.binfo = &binfo;
+    sw.nPlayers = nPlayers;
+    sw.seed = seed;
+    sw.nGames = nGames;
+    for (unsigned int i = 0; i < nPlayers; ++i) {
+        sw.strategies[i] = parse_strategy(strategies[i]);
+        sw.params[i] = AVOID_PARAMS_DEFAULT;
+    }
+    sw.outcome = (unsigned char *) malloc(nGames);
+    assert(sw.outcome != NULL);
+    sw.states = (GameState_t *) malloc(nThreads * sizeof(GameState_t));
+    assert(sw.states != NULL);
+    sw.states_valid = (bool *) calloc(nThreads, sizeof(bool));
+    assert(sw.states_valid != NULL);
+    unsigned char *baseline = (unsigned char *) malloc(nGames);
+    assert(baseline != NULL);
+
+    // Reference: default parameters on the same games
+    const unsigned int base_wins = sweep_eval(&sw, &pool, &AVOID_PARAMS_DEFAULT);
+    memcpy(baseline, sw.outcome, nGames);
+    printf("# strategies: %s, games per setting: %u, seed: %lu, threads: %u, "
+           "EXPECTIMAX leaf: %s\n", strategies, nGames, (unsigned long)seed,
+           nThreads, endgame_leaf ? "endgame tables" : "tour");
+    printf("# default (%.2f, %.2f): win rate %.4f\n", BASE_AVOIDANCE_DEFAULT,
+           FAR_FACTOR_DEFAULT, (double)base_wins / nGames);
+    printf("round,base_avoidance,far_factor,games,wins,win_rate,ci_low,ci_high,"
+           "diff,diff_ci_low,diff_ci_high\n");
+
+    AvoidParams_t best = AVOID_PARAMS_DEFAULT;
+    double best_rate = (double)base_wins / nGames;
+    for (unsigned int round = 0; round <= rounds; ++round) {
+        const unsigned int nb = range_size(&base), nf = range_size(&far);
+        AvoidParams_t round_best = best;
+        double round_best_rate = -1.0;
+        for (unsigned int ib = 0; ib < nb; ++ib) {
+            for (unsigned int jf = 0; jf < nf; ++jf) {
+                AvoidParams_t params = {
+                    .base_avoidance = base.lo + ib * base.step,
+                    .far_factor = far.lo + jf * far.step
+                };
+                const unsigned int wins = sweep_eval(&sw, &pool, &params);
+                double lo, hi, diff, half;
+                wilson(wins, nGames, &lo, &hi);
+                paired_diff(sw.outcome, baseline, nGames, &diff, &half);
+                printf("%u,%.4f,%.4f,%u,%u,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n",
+                       round, params.base_avoidance, params.far_factor, nGames,
+                       wins, (double)wins / nGames, lo, hi, diff, diff - half,
+                       diff + half);
+                fflush(stdout);
+                if ((double)wins / nGames > round_best_rate) {
+                    round_best_rate = (double)wins / nGames;
+                    round_best = params;
+                }
+            }
+        }
+        if (round_best_rate > best_rate) {
+            best_rate = round_best_rate;
+            best = round_best;
+        }
+        // Zoom in around best setting of this round (far factor stays
+        // positive, i.e. at least one step of the zoomed range)
+        base = range_zoom(&base, round_best.base_avoidance, 0.0);
+        far = range_zoom(&far, round_best.far_factor, far.step / 2.0);
+    }
+    printf("# best (%.4f, %.4f): win rate %.4f\n", best.base_avoidance,
+           best.far_factor, best_rate);
+
+    // Cleanup
+    for (unsigned int i = 0; i < nThreads; ++i) {
+        if (sw.states_valid[i])
+            GameState_free(&sw.states[i]);
+    }
+    free(sw.states);
+    free(sw.states_valid);
+    free(sw.outcome);
+    free(baseline);
+    ThreadPool_free(&pool);
+    BoardInfo_free(&binfo);
+    return 0;
+}
@@ -0,0 +1,554 @@
+/*
+ * Throughput regression check of whole games (see GameState_simulate).
+ *
+ * - Plays a fixed-seed batch of games for every case of a matrix of player
+ *   counts (MIN_PLAYERS..MAX_PLAYERS) and strategy mixes (all GREEDY, all
+ *   AVOIDANT, one AVOIDANT among GREEDY), or for the given strategies
+ * - The baseline (JSON, checked in, written by -u) holds the number of
+ *   moves, games/sec and moves/sec of every case
+ * - Moves: must equal the baseline. They only depend on the games and thus
+ *   hold on any machine and for any number of threads; a different count
+ *   means the games changed and the baseline needs to be refreshed
+ * - Hash: the first CHECK_GAMES games of every case are replayed move by
+ *   move, and after every move the incremental Zobrist hash must equal the
+ *   hash recomputed from scratch (GameState_hash)
+ * - Batch engine: for cases of GREEDY players only, the same games are
+ *   also played by the lockstep batch engine (see batch_sim.h), and every
+ *   game must have the same result & turn order as played move by move
+ *   (second copy of the GREEDY rules and book keeping)
+ * - Rates: a case fails if games/sec or moves/sec drop more than the
+ *   tolerance (-T) below the baseline. To keep noise manageable:
+ *   - every repetition plays the batch as many times as needed to last at
+ *     least the minimum time (-m), and the median of the repetitions (-r)
+ *     is used
+ *   - rates are normalized by the speed of the machine: before every
+ *     repetition of a case, a fixed calibration loop (pointer chasing &
+ *     integer mixing, independent of the simulation) is timed the same
+ *     way, and rates are compared as games (moves) per calibration step.
+ *     This cancels most of the drift of clock frequency and load of shared
+ *     hosts, and part of the difference between machines
+ *   - the default tolerance (CHECK_TOLERANCE) is wide: the normalized rates
+ *     of the same build still spread by up to ~20% between runs on shared
+ *     hosts, and by more between different microarchitectures. The gate
+ *     only catches regressions beyond the tolerance; smaller ones (e.g.
+ *     losing the batch engine of all GREEDY games costs ~10-20%) need more
+ *     repetitions (-r) and a tighter tolerance on an idle machine, or
+ *     fang_bench
+ *   - rates are only compared if the number of threads matches the baseline
+ *   - write the baseline with more repetitions (-u -r 9) on an idle machine;
+ *     a fast outlier in the baseline fails later runs
+ * - -c only checks moves & hash (1 repetition, no minimum time), e.g. for quick
+ *   checks while changing the games
+ * - The exit status is non-zero if any case failed
+ *
+ * Usage: ./throughput [-n games] [-r reps] [-m min. seconds] [-s seed]
+ *                     [-t threads] [-T tolerance %] [-b baseline] [-c] [-u]
+ *                     [strategies ...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>  // getopt
+
+#include "game_state.h"
+
+#define THROUGHPUT_BASELINE "tools/throughput_baseline.json"
+#define MAX_CASES (64)
+#define CASE_NAME_SIZE (MAX_PLAYERS + 1)
+#define LINE_SIZE (512)
+#define MAX_REPS (64)
+// Defaults of the gate (see top)
+#define CHECK_REPS (5)
+#define CHECK_MIN_SECONDS (0.5)
+#define CHECK_TOLERANCE (30.0)  // percent
+#define CHECK_GAMES (2000)      // replayed per case (hash, batch engine)
+// Calibration loop: chase a random cycle through CALIBRATION_SIZE entries
+// in chunks of CALIBRATION_STEPS. The table (16 KiB) stays in cache, such
+// that the loop follows the clock & share of the core; a table that spills
+// to memory made the normalized rates noisier than the raw ones
+#define CALIBRATION_SIZE (1U << 12)
+#define CALIBRATION_STEPS (1UL << 20)
+#define CALIBRATION_SEED (0x5eedca11b7a7e000ULL)
+
+typedef struct {
+    char name[CASE_NAME_SIZE];  // strategies, e.g. "aggg"
+    unsigned long games;        // per batch
+    unsigned long moves;        // per batch
+    double seconds;             // per batch (median repetition)
+    double games_per_sec;
+    double moves_per_sec;
+    double calibration_per_sec; // steps of calibration loop (median)
+} Case;
+
+static enum MOVE_STRATEGY parse_strategy(char c)
+{
+    switch (c) {
+        case 'a': return AVOIDANT;
+        case 'e': return EXPECTIMAX;
+        case 'g': return GREEDY;
+        case 'm': return MCTS;
+        case 't': return ENDGAME;
+        default:
+            fprintf(stderr, "Did not recognize strategy: '%c'\n", c);
+            exit(EXIT_FAILURE);
+    }
+}
+
+static void add_case(Case *cases, unsigned int *nCases, const char *name)
+{
+    const size_t nPlayers = strlen(name);
+    if (nPlayers < MIN_PLAYERS || nPlayers > MAX_PLAYERS) {
+        fprintf(stderr, "Need %d to %d strategies: '%s'\n", MIN_PLAYERS,
+                MAX_PLAYERS, name);
+        exit(EXIT_FAILURE);
+    }
+    if (*nCases == MAX_CASES) {
+        fprintf(stderr, "Too many cases (at most %d)\n", MAX_CASES);
+        exit(EXIT_FAILURE);
+    }
+    Case *c = &cases[(*nCases)++];
+    memset(c, 0, sizeof(Case));
+    memcpy(c->name, name, nPlayers + 1);
+}
+
+// Default matrix of player counts & strategy mixes
+static void add_matrix(Case *cases, unsigned int *nCases)
+{
+    char name[CASE_NAME_SIZE];
+    for (unsigned int p = MIN_PLAYERS; p <= MAX_PLAYERS; ++p) {
+        name[p] = '\0';
+        memset(name, 'g', p);
+        add_case(cases, nCases, name);
+        memset(name, 'a', p);
+        add_case(cases, nCases, name);
+        memset(name + 1, 'g', p - 1);
+        add_case(cases, nCases, name);
+    }
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    const double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+static double median(double *values, unsigned int n)
+{
+    qsort(values, n, sizeof(double), cmp_double);
+    return n % 2 == 1 ? values[n / 2] :
+           0.5 * (values[n / 2 - 1] + values[n / 2]);
+}
+
+static volatile uint64_t calibration_sink;
+
+// Single random cycle through all entries of the calibration loop
+// (Sattolo's algorithm, fixed seed)
+static unsigned int *calibration_init(void)
+{
+    unsigned int *next_index = (unsigned int *)
+            malloc(CALIBRATION_SIZE * sizeof(unsigned int));
+    assert(next_index != NULL);
+    uint64_t state = CALIBRATION_SEED;
+    unsigned int i, j, tmp;
+    for (i = 0; i < CALIBRATION_SIZE; ++i)
+        next_index[i] = i;
+    for (i = CALIBRATION_SIZE - 1; i > 0; --i) {
+        j = next_r(&state) % i;
+        tmp = next_index[i];
+        next_index[i] = next_index[j];
+        next_index[j] = tmp;
+    }
+    return next_index;
+}
+
+// Steps per second of the calibration loop, run in chunks until at least
+// min_seconds have passed
+static double calibration_rate(const unsigned int *next_index,
+                               double min_seconds)
+{
+    unsigned long steps = 0;
+    unsigned int i = 0;
+    uint64_t mix = 0;
+    const uint64_t start = MoveTiming_now();
+    double seconds;
+    do {
+        for (unsigned long k = 0; k < CALIBRATION_STEPS; ++k) {
+            i = next_index[i];
+            // Some integer work per load (like a move between lookups)
+            mix = (mix ^ i) * 0xbf58476d1ce4e5b9ULL;
+            mix ^= mix >> 31;
+        }
+        steps += CALIBRATION_STEPS;
+        seconds = 1e-9 * (MoveTiming_now() - start);
+    } while (seconds < min_seconds);
+    calibration_sink = mix;  // keep loop
+    return steps / seconds;
+}
+
+// Median over reps of time per batch of all games of case, where every
+// repetition plays the batch until at least min_seconds have passed; every
+// repetition is preceded by one of the calibration loop (if next_index)
+static void run_case(const BoardInfo_t *binfo, Case *c, unsigned long nGames,
+                     unsigned int reps, double min_seconds,
+                     const SimOptions_t *opts, const unsigned int *next_index)
+{
+    const unsigned int nPlayers = strlen(c->name);
+    enum MOVE_STRATEGY player_strategies[MAX_PLAYERS];
+    for (unsigned int i = 0; i < nPlayers; ++i)
+        player_strategies[i] = parse_strategy(c->name[i]);
+
+    double per_batch[MAX_REPS], calibration[MAX_REPS];
+    c->games = nGames;
+    for (unsigned int r = 0; r < reps; ++r) {
+        if (next_index != NULL)
+            calibration[r] = calibration_rate(next_index, min_seconds);
+        unsigned long batches = 0;
+        const uint64_t start = MoveTiming_now();
+        double seconds;
+        do {
+            SimStats_t stats;
+            const int status = GameState_simulate(binfo, nPlayers,
+                    player_strategies, nGames, opts, &stats);
+            if (status != 0) {
+                fprintf(stderr, "Could not simulate '%s'\n", c->name);
+                exit(EXIT_FAILURE);
+            }
+            // Same seed, same games
+            assert((r == 0 && batches == 0) || stats.nMoves == c->moves);
+            c->moves = stats.nMoves;
+            ++batches;
+            seconds = 1e-9 * (MoveTiming_now() - start);
+        } while (seconds < min_seconds);
+        per_batch[r] = seconds / batches;
+    }
+    c->seconds = median(per_batch, reps);
+    c->games_per_sec = c->games / c->seconds;
+    c->moves_per_sec = c->moves / c->seconds;
+    c->calibration_per_sec = next_index != NULL ?
+            median(calibration, reps) : 0.0;
+}
+
+static void write_baseline(const char *path, const Case *cases,
+                           unsigned int nCases, uint64_t seed,
+                           unsigned int nThreads)
+{
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        fprintf(stderr, "Could not open '%s'\n", path);
+        exit(EXIT_FAILURE);
+    }
+    fprintf(fp, "{\n  \"seed\": %lu,\n", (unsigned long) seed);
+    fprintf(fp, "  \"threads\": %u,\n", nThreads);
+    fprintf(fp, "  \"cases\": [\n");
+    for (unsigned int i = 0; i < nCases; ++i) {
+        const Case *c = &cases[i];
+        fprintf(fp, "    {\"name\": \"%s\", \"games\": %lu, \"moves\": %lu, "
+                "\"games_per_sec\": %.1f, \"moves_per_sec\": %.1f, "
+                "\"calibration_per_sec\": %.1f}%s\n", c->name, c->games,
+                c->moves, c->games_per_sec, c->moves_per_sec,
+                c->calibration_per_sec, i + 1 < nCases ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+    fclose(fp);
+}
+
+// Value of "key": in line (false if missing)
+static bool json_number(const char *line, const char *key, double *value)
+{
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    const char *p = strstr(line, pattern);
+    return p != NULL && sscanf(p + strlen(pattern), "%lf", value) == 1;
+}
+
+static bool json_string(const char *line, const char *key, char *value,
+                        size_t size)
+{
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\": \"", key);
+    const char *p = strstr(line, pattern);
+    if (p == NULL)
+        return false;
+    p += strlen(pattern);
+    const char *end = strchr(p, '"');
+    if (end == NULL || (size_t)(end - p) >= size)
+        return false;
+    memcpy(value, p, end - p);
+    value[end - p] = '\0';
+    return true;
+}
+
+// Read baseline written by write_baseline (one case per line); returns
+// number of cases or -1 if file could not be opened
+static int read_baseline(const char *path, Case *cases, uint64_t *seed,
+                         unsigned int *nThreads)
+{
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+        return -1;
+    char line[LINE_SIZE];
+    unsigned int nCases = 0;
+    double value;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        const char *p = strstr(line, "\"seed\":");
+        if (p != NULL)
+            *seed = strtoull(p + strlen("\"seed\":"), NULL, 10);  // exact
+        if (json_number(line, "threads", &value))
+            *nThreads = (unsigned int) value;
+        Case c;
+        memset(&c, 0, sizeof(Case));
+        if (!json_string(line, "name", c.name, sizeof(c.name)))
+            continue;
+        double games, moves;
+        if (!json_number(line, "games", &games) ||
+                !json_number(line, "moves", &moves) ||
+                !json_number(line, "games_per_sec", &c.games_per_sec) ||
+                !json_number(line, "moves_per_sec", &c.moves_per_sec) ||
+                !json_number(line, "calibration_per_sec",
+                             &c.calibration_per_sec) ||
+                c.calibration_per_sec <= 0.0) {
+            fprintf(stderr, "Malformed case in '%s': %s", path, line);
+            exit(EXIT_FAILURE);
+        }
+        c.games = (unsigned long) games;
+        c.moves = (unsigned long) moves;
+        if (nCases == MAX_CASES)
+            break;
+        cases[nCases++] = c;
+    }
+    fclose(fp);
+    return (int) nCases;
+}
+
+static const Case *find_case(const Case *cases, int nCases, const char *name)
+{
+    for (int i = 0; i < nCases; ++i) {
+        if (strcmp(cases[i].name, name) == 0)
+            return &cases[i];
+    }
+    return NULL;
+}
+
+static bool same_result(const GameResult_t *a, const GameResult_t *b,
+                        unsigned int nPlayers)
+{
+    if (a->winner != b->winner || a->nTurns != b->nTurns ||
+            a->winTurn != b->winTurn || a->nRanked != b->nRanked ||
+            a->nMoves != b->nMoves)
+        return false;
+    for (unsigned int i = 0; i < a->nRanked; ++i) {
+        if (a->ranking[i] != b->ranking[i])
+            return false;
+    }
+    for (unsigned int i = 0; i < nPlayers; ++i) {
+        if (a->captures[i] != b->captures[i])
+            return false;
+    }
+    return true;
+}
+
+// Replay the first games of case move by move; returns number of moves
+// after which the incremental hash differed from the one from scratch and
+// writes number of games the batch engine played differently to
+// nWrongBatch (only GREEDY players)
+static unsigned long check_games(const BoardInfo_t *binfo, const Case *c,
+                                 unsigned long nGames, uint64_t seed,
+                                 unsigned long *nWrongBatch)
+{
+    const unsigned int nPlayers = strlen(c->name);
+    enum MOVE_STRATEGY player_strategies[MAX_PLAYERS];
+    AvoidParams_t player_params[MAX_PLAYERS];
+    for (unsigned int i = 0; i < nPlayers; ++i) {
+        player_strategies[i] = parse_strategy(c->name[i]);
+        player_params[i] = AVOID_PARAMS_DEFAULT;
+    }
+    const unsigned long nCheck = nGames < CHECK_GAMES ? nGames : CHECK_GAMES;
+    GameState_t gstate;
+    GameState_init(&gstate, nPlayers, binfo->nPositions);
+    BatchResult_t *batch = NULL;
+    if (strspn(c->name, "g") == nPlayers) {
+        batch = (BatchResult_t *) malloc(nCheck * sizeof(BatchResult_t));
+        assert(batch != NULL);
+        BatchSim_run(binfo, &gstate, seed, 0, nCheck, false, batch);
+    }
+    GameStepper_t stepper;
+    unsigned long nWrong = 0;
+    *nWrongBatch = 0;
+    for (unsigned long i = 0; i < nCheck; ++i) {
+        set_seed(derive_seed(seed, i));
+        GameState_reset(&gstate, binfo->nPositions);
+        GameStepper_init(&stepper, &gstate, false);
+        while (!stepper.done) {
+            GameStepper_step(binfo, &stepper, &gstate, player_strategies,
+                             player_params, false);
+            nWrong += gstate.hash != GameState_hash(&gstate);
+        }
+        if (batch != NULL) {
+            const GameResult_t result = GameStepper_result(&stepper);
+            *nWrongBatch += !same_result(&batch[i].result, &result, nPlayers) ||
+                    memcmp(batch[i].player_order, gstate.player_order,
+                           nPlayers * sizeof(unsigned int)) != 0;
+        }
+    }
+    free(batch);
+    GameState_free(&gstate);
+    return nWrong;
+}
+
+// Rate of case relative to baseline, normalized by the calibration loop;
+// the slower of games/sec and moves/sec
+static double normalized_ratio(const Case *c, const Case *b)
+{
+    const double speed = c->calibration_per_sec / b->calibration_per_sec;
+    double ratio = c->games_per_sec / (b->games_per_sec * speed);
+    if (c->moves_per_sec / (b->moves_per_sec * speed) < ratio)
+        ratio = c->moves_per_sec / (b->moves_per_sec * speed);
+    return ratio;
+}
+
+int main(int argc, char *argv[]) {
+
+    unsigned long nGames = 20000;
+    unsigned int reps = 0;     // 0: CHECK_REPS, or 1 if only moves (-c)
+    double min_seconds = -1.0; // < 0: CHECK_MIN_SECONDS, or 0 (-c)
+    double tolerance = CHECK_TOLERANCE;  // percent
+    const char *baseline_path = THROUGHPUT_BASELINE;
+    bool moves_only = false;
+    bool update = false;
+    SimOptions_t opts = {.seed = 42, .nThreads = 1, .ckpt_path = NULL,
+                         .ckpt_interval = 0, .resume = false, .timing = NULL};
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:r:m:s:t:T:b:cu")) != -1) {
+        switch (opt) {
+            case 'n': nGames = strtoul(optarg, NULL, 10); break;
+            case 'r': reps = atoi(optarg); break;
+            case 'm': min_seconds = atof(optarg); break;
+            case 's': opts.seed = strtoull(optarg, NULL, 10); break;
+            case 't': opts.nThreads = atoi(optarg); break;
+            case 'T': tolerance = atof(optarg); break;
+            case 'b': baseline_path = optarg; break;
+            case 'c': moves_only = true; break;
+            case 'u': update = true; break;
+            default:
+                fprintf(stderr, "Usage: ./throughput [-n games] [-r reps] "
+                        "[-m min. seconds] [-s seed] [-t threads] "
+                        "[-T tolerance %%] [-b baseline] [-c] [-u] "
+                        "[strategies ...]\n");
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (moves_only && update) {
+        fprintf(stderr, "Baseline needs rates (-u excludes -c)\n");
+        exit(EXIT_FAILURE);
+    }
+    if (reps == 0)
+        reps = moves_only ? 1 : CHECK_REPS;
+    if (min_seconds < 0.0)
+        min_seconds = moves_only ? 0.0 : CHECK_MIN_SECONDS;
+    if (reps > MAX_REPS || nGames == 0 || tolerance <= 0.0) {
+        fprintf(stderr, "Need at least 1 game, 1 to %d repetitions and a "
+                "positive tolerance\n", MAX_REPS);
+        exit(EXIT_FAILURE);
+    }
+    Case cases[MAX_CASES];
+    unsigned int nCases = 0;
+    if (optind < argc) {
+        for (int i = optind; i < argc; ++i)
+            add_case(cases, &nCases, argv[i]);
+    } else {
+        add_matrix(cases, &nCases);
+    }
+
+    // Not needed when writing a new one
+    Case base[MAX_CASES];
+    uint64_t base_seed = opts.seed;
+    unsigned int base_threads = opts.nThreads;
+    int nBase = update ? 0 : read_baseline(baseline_path, base,
+                                           &base_seed, &base_threads);
+    if (nBase < 0) {
+        fprintf(stderr, "Could not open baseline '%s' (write one with -u)\n",
+                baseline_path);
+        exit(EXIT_FAILURE);
+    }
+    if (nBase > 0 && base_seed != opts.seed) {
+        fprintf(stderr, "Baseline was measured with seed %lu\n",
+                (unsigned long) base_seed);
+        exit(EXIT_FAILURE);
+    }
+    const bool compare_rates = !update && !moves_only &&
+                               base_threads == opts.nThreads;
+    if (!update && !moves_only && !compare_rates) {
+        printf("Rates of baseline were measured on %u threads, only moves "
+               "are checked\n", base_threads);
+    }
+    unsigned int *next_index = moves_only ? NULL : calibration_init();
+
+    BoardInfo_t binfo;
+    BoardInfo_init(&binfo);
+    for (unsigned int i = 0; i < nCases; ++i) {
+        if (strchr(cases[i].name, 't') != NULL && !Endgame_load(&binfo)) {
+            fprintf(stderr, "Could not load endgame tables (run 'make endgame')\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    printf("%-8s %10s %12s %12s %14s %11s  %s\n", "case", "games", "moves",
+           "games/sec", "moves/sec", "vs. base", "status");
+    unsigned int nFailed = 0;
+    for (unsigned int i = 0; i < nCases; ++i) {
+        Case *c = &cases[i];
+        run_case(&binfo, c, nGames, reps, min_seconds, &opts, next_index);
+        unsigned long nWrongBatch;
+        const unsigned long nWrongHash = check_games(&binfo, c, nGames,
+                                                     opts.seed, &nWrongBatch);
+        printf("%-8s %10lu %12lu %12.1f %14.1f", c->name, c->games, c->moves,
+               c->games_per_sec, c->moves_per_sec);
+        const Case *b = update ? NULL : find_case(base, nBase, c->name);
+        double ratio = 1.0;
+        if (compare_rates && b != NULL && b->games == c->games) {
+            ratio = normalized_ratio(c, b);
+            printf(" %+10.1f%%", 100.0 * (ratio - 1.0));
+        } else {
+            printf(" %11s", "-");
+        }
+        if (nWrongHash > 0) {
+            printf("  FAIL (wrong hash in %lu moves)\n", nWrongHash);
+            ++nFailed;
+        } else if (nWrongBatch > 0) {
+            printf("  FAIL (batch engine differs in %lu games)\n", nWrongBatch);
+            ++nFailed;
+        } else if (update) {
+            printf("\n");
+        } else if (b == NULL || b->games != c->games) {
+            printf("  no baseline\n");
+        } else if (c->moves != b->moves) {
+            printf("  FAIL (%lu moves in baseline)\n", b->moves);
+            ++nFailed;
+        } else if (ratio < 1.0 - 0.01 * tolerance) {
+            printf("  FAIL (regression)\n");
+            ++nFailed;
+        } else {
+            printf("  ok\n");
+        }
+        fflush(stdout);
+    }
+
+    if (update) {
+        write_baseline(baseline_path, cases, nCases, opts.seed, opts.nThreads);
+        printf("Baseline written to '%s'\n", baseline_path);
+    }
+    if (nFailed > 0) {
+        printf("%u of %u cases failed", nFailed, nCases);
+        if (compare_rates)
+            printf(" (tolerance %.1f%%)", tolerance);
+        printf("\n");
+    }
+
+    // Cleanup
+    free(next_index);
+    BoardInfo_free(&binfo);
+    return nFailed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
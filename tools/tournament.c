@@ -0,0 +1,323 @@
+/*
+ * Round-robin tournament between strategies.
+ *
+ * - Enumerates all lineups (multisets of nPlayers strategies out of the
+ *   given pool, except lineups of a single strategy) and plays every
+ *   lineup in all cyclic seat rotations
+ * - All rotations of a lineup play the same games (common random
+ *   numbers): game i of a lineup is played from the same seed, only
+ *   the seats of the strategies differ
+ * - All games of the tournament are scheduled on one shared thread pool;
+ *   the board is initialized once
+ * - Ratings: Plackett-Luce (top-1) strengths fitted by MM iterations to
+ *   the winners of all games, reported on the Elo scale (mean 1500)
+ * - Win rate of strategy per seat it took (a lineup may seat a strategy
+ *   several times, every seat counts)
+ * - Pairwise win matrix: win rate of strategy (row) in games in which the
+ *   other strategy (column) took part
+ * - Pool of distinct strategies; ENDGAME needs the endgame tables of the
+ *   board (see endgame_gen), hence is not part of the default pool
+ * - With -E, EXPECTIMAX estimates leaves by the endgame tables instead of
+ *   a nearest-neighbor tour
+ *
+ * Usage: ./tournament [-n games per seating] [-p players] [-s seed]
+ *                     [-t threads] [-E] [strategies (default: aeg)]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>  // getopt
+#include <math.h>
+
+#include "game_state.h"
+#include "thread_pool.h"
+
+#define TOURNAMENT_CHUNK (4)
+#define MAX_STRATEGIES (8)
+#define RATING_ITERS (1000)
+#define RATING_EPS (1e-10)
+
+typedef struct {
+    unsigned int strat[MAX_PLAYERS];  // indices into pool (non-decreasing)
+} Lineup;
+
+typedef struct {
+    const BoardInfo_t *binfo;
+    enum MOVE_STRATEGY pool[MAX_STRATEGIES];
+    unsigned int nStrategies;
+    unsigned int nPlayers;
+    Lineup *lineups;
+    unsigned int nLineups;
+    unsigned int nGames;      // per lineup & rotation
+    uint64_t seed;
+    unsigned long nTotal;     // total number of games
+    atomic_ulong next;        // next game to be claimed
+    signed char *winner;      // seat of winner per game (-1: undecided)
+    GameState_t *states;      // one game per worker
+} Tournament;
+
+// Append all multisets of size nPlayers (indices >= first) to lineups
+static void enumerate(Tournament *t, Lineup *current, unsigned int depth,
+                      unsigned int first, unsigned int capacity)
+{
+    if (depth == t->nPlayers) {
+        // Skip lineups of a single strategy
+        if (current->strat[0] == current->strat[t->nPlayers - 1])
+            return;
+        assert(t->nLineups < capacity);
+        t->lineups[t->nLineups++] = *current;
+        return;
+    }
+    for (unsigned int s = first; s < t->nStrategies; ++s) {
+        current->strat[depth] = s;
+        enumerate(t, current, depth + 1, s, capacity);
+    }
+}
+
+// Strategy (index into pool) of seat in given game
+static inline unsigned int seat_strategy(const Tournament *t, unsigned long game,
+                                         unsigned int seat)
+{
+    const unsigned long lineup = game / ((unsigned long)t->nPlayers * t->nGames);
+    const unsigned int rotation = (game / t->nGames) % t->nPlayers;
+    return t->lineups[lineup].strat[(seat + rotation) % t->nPlayers];
+}
+
+static void tournament_worker(void *arg, unsigned int worker_id)
+{
+    Tournament *t = (Tournament *) arg;
+    GameState_t *gstate = &t->states[worker_id];
+    GameState_init(gstate, t->nPlayers, t->binfo->nPositions);
+    enum MOVE_STRATEGY strategies[MAX_PLAYERS];
+    AvoidParams_t params[MAX_PLAYERS];
+    unsigned int seat;
+    for (seat = 0; seat < t->nPlayers; ++seat)
+        params[seat] = AVOID_PARAMS_DEFAULT;
+
+    unsigned long start, game;
+    while ((start = atomic_fetch_add(&t->next, TOURNAMENT_CHUNK)) < t->nTotal) {
+        for (game = start; game < start + TOURNAMENT_CHUNK && game < t->nTotal; ++game) {
+            for (seat = 0; seat < t->nPlayers; ++seat)
+                strategies[seat] = t->pool[seat_strategy(t, game, seat)];
+            // Same seed for all rotations of a lineup
+            const unsigned long lineup = game / ((unsigned long)t->nPlayers * t->nGames);
+            set_seed(derive_seed(t->seed, lineup * t->nGames + game % t->nGames));
+            GameState_reset(gstate, t->binfo->nPositions);
+            GameResult_t result = GameState_run(t->binfo, gstate, strategies,
+                                                params, true, false);
+            t->winner[game] = (signed char)result.winner;
+        }
+    }
+    GameState_free(gstate);
+}
+
+// Fit Plackett-Luce strengths to winners (MM algorithm); ratings are
+// returned on the Elo scale
+static void fit_ratings(const Tournament *t, double *rating)
+{
+    const unsigned int S = t->nStrategies;
+    double gamma[MAX_STRATEGIES], wins[MAX_STRATEGIES], denom[MAX_STRATEGIES];
+    unsigned int counts[MAX_STRATEGIES];
+    unsigned int s, seat;
+    unsigned long game;
+
+    for (s = 0; s < S; ++s) {
+        gamma[s] = 1.0;
+        wins[s] = 0.0;
+    }
+    for (game = 0; game < t->nTotal; ++game) {
+        if (t->winner[game] >= 0)
+            wins[seat_strategy(t, game, t->winner[game])] += 1.0;
+    }
+    for (unsigned int iter = 0; iter < RATING_ITERS; ++iter) {
+        for (s = 0; s < S; ++s)
+            denom[s] = 0.0;
+        for (game = 0; game < t->nTotal; ++game) {
+            if (t->winner[game] < 0)
+                continue;
+            double total = 0.0;
+            for (s = 0; s < S; ++s)
+                counts[s] = 0;
+            for (seat = 0; seat < t->nPlayers; ++seat)
+                ++counts[seat_strategy(t, game, seat)];
+            for (s = 0; s < S; ++s)
+                total += counts[s] * gamma[s];
+            for (s = 0; s < S; ++s)
+                denom[s] += counts[s] / total;
+        }
+        double change = 0.0, log_mean = 0.0;
+        for (s = 0; s < S; ++s) {
+            // Strategies that never win keep a tiny strength
+            const double g = wins[s] > 0.0 ? wins[s] / denom[s] : 1e-6;
+            change = fmax(change, fabs(g - gamma[s]) / gamma[s]);
+            gamma[s] = g;
+            log_mean += log(g) / S;
+        }
+        // Normalize (geometric mean 1)
+        for (s = 0; s < S; ++s)
+            gamma[s] /= exp(log_mean);
+        if (change < RATING_EPS)
+            break;
+    }
+    for (s = 0; s < S; ++s)
+        rating[s] = 1500.0 + 400.0 * log10(gamma[s]);
+}
+
+static enum MOVE_STRATEGY parse_strategy(char c)
+{
+    switch (c) {
+        case 'a': return AVOIDANT;
+        case 'e': return EXPECTIMAX;
+        case 'g': return GREEDY;
+        case 't': return ENDGAME;
+        default:
+            fprintf(stderr, "Did not recognize strategy: '%c' "
+                    "(MCTS cannot be used in tournaments)\n", c);
+            exit(EXIT_FAILURE);
+    }
+}
+
+int main(int argc, char *argv[]) {
+
+    unsigned int nGames = 100;
+    unsigned int nPlayers = 4;
+    uint64_t seed = 42;
+    unsigned int nThreads = ThreadPool_num_cores();
+    bool endgame_leaf = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:p:s:t:E")) != -1) {
+        switch (opt) {
+            case 'n': nGames = atoi(optarg); break;
+            case 'p': nPlayers = atoi(optarg); break;
+            case 's': seed = strtoull(optarg, NULL, 10); break;
+            case 't': nThreads = atoi(optarg); break;
+            case 'E': endgame_leaf = true; break;
+            default:
+                fprintf(stderr, "Usage: ./tournament [-n games] [-p players] "
+                        "[-s seed] [-t threads] [-E] [strategies]\n");
+                exit(EXIT_FAILURE);
+        }
+    }
+    const char *strategies = optind < argc ? argv[optind] : "aeg";
+    const unsigned int nStrategies = strlen(strategies);
+    if (nPlayers < MIN_PLAYERS || nPlayers > MAX_PLAYERS) {
+        fprintf(stderr, "Invalid number of players\n");
+        exit(EXIT_FAILURE);
+    }
+    if (nStrategies < 2 || nStrategies > MAX_STRATEGIES || nGames == 0 || nThreads == 0) {
+        fprintf(stderr, "Need 2 to %d strategies, at least one game & thread\n",
+                MAX_STRATEGIES);
+        exit(EXIT_FAILURE);
+    }
+
+    BoardInfo_t binfo;
+    BoardInfo_init(&binfo);
+    Tournament t;
+    t.binfo = &binfo;
+    t.nStrategies = nStrategies;
+    t.nPlayers = nPlayers;
+    t.nGames = nGames;
+    t.seed = seed;
+    for (unsigned int s = 0; s < nStrategies; ++s) {
+        t.pool[s] = parse_strategy(strategies[s]);
+        // Duplicates would be counted as two strategies
+        if (strchr(strategies, strategies[s]) != &strategies[s]) {
+            fprintf(stderr, "Strategy '%c' appears more than once\n", strategies[s]);
+            exit(EXIT_FAILURE);
+        }
+        if (t.pool[s] == ENDGAME && !Endgame_load(&binfo)) {
+            fprintf(stderr, "Could not load endgame tables (run 'make endgame')\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (endgame_leaf && !Expectimax_use_endgame(&binfo)) {
+        fprintf(stderr, "Could not load endgame tables (run 'make endgame')\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Number of multisets: C(nStrategies + nPlayers - 1, nPlayers)
+    unsigned int capacity = 1;
+    for (unsigned int k = 1; k <= nPlayers; ++k)
+        capacity = capacity * (nStrategies + k - 1) / k;
+    t.lineups = (Lineup *) malloc(capacity * sizeof(Lineup));
+    assert(t.lineups != NULL);
+    t.nLineups = 0;
+    Lineup current;
+    enumerate(&t, &current, 0, 0, capacity);
+
+    t.nTotal = (unsigned long)t.nLineups * nPlayers * nGames;
+    t.winner = (signed char *) malloc(t.nTotal);
+    assert(t.winner != NULL);
+    t.states = (GameState_t *) malloc(nThreads * sizeof(GameState_t));
+    assert(t.states != NULL);
+    atomic_init(&t.next, 0);
+
+    printf("#Players: %u, #Lineups: %u, #Games: %lu, #Threads: %u, "
+           "#EXPECTIMAX leaf: %s\n", nPlayers, t.nLineups, t.nTotal, nThreads,
+           endgame_leaf ? "endgame tables" : "tour");
+    ThreadPool pool;
+    ThreadPool_init(&pool, nThreads);
+    ThreadPool_run(&pool, tournament_worker, &t);
+    ThreadPool_free(&pool);
+
+    // Aggregate results
+    unsigned long played[MAX_STRATEGIES] = {0}, won[MAX_STRATEGIES] = {0};
+    unsigned long pair_games[MAX_STRATEGIES][MAX_STRATEGIES] = {{0}};
+    unsigned long pair_wins[MAX_STRATEGIES][MAX_STRATEGIES] = {{0}};
+    unsigned long nUndecided = 0;
+    for (unsigned long game = 0; game < t.nTotal; ++game) {
+        bool present[MAX_STRATEGIES] = {false};
+        for (unsigned int seat = 0; seat < nPlayers; ++seat) {
+            const unsigned int s = seat_strategy(&t, game, seat);
+            ++played[s];  // counted per seat taken
+            present[s] = true;
+        }
+        const int w = t.winner[game] >= 0 ? (int)seat_strategy(&t, game, t.winner[game]) : -1;
+        if (w < 0)
+            ++nUndecided;
+        else
+            ++won[w];
+        for (unsigned int a = 0; a < nStrategies; ++a) {
+            for (unsigned int b = 0; b < nStrategies; ++b) {
+                if (a == b || !present[a] || !present[b])
+                    continue;
+                ++pair_games[a][b];
+                if (w == (int)a)
+                    ++pair_wins[a][b];
+            }
+        }
+    }
+    double rating[MAX_STRATEGIES];
+    fit_ratings(&t, rating);
+
+    printf("Undecided games: %lu\n\n", nUndecided);
+    printf("%-12s %8s %12s %16s\n", "Strategy", "Rating", "Seats taken",
+           "Wins/seat taken");
+    for (unsigned int s = 0; s < nStrategies; ++s) {
+        printf("%-12s %8.1f %12lu %16.4f\n", STRATEGY_NAMES[t.pool[s]], rating[s],
+               played[s], (double)won[s] / played[s]);
+    }
+    printf("\nWin rate of row in games against column:\n%-12s", "");
+    for (unsigned int b = 0; b < nStrategies; ++b)
+        printf(" %12s", STRATEGY_NAMES[t.pool[b]]);
+    printf("\n");
+    for (unsigned int a = 0; a < nStrategies; ++a) {
+        printf("%-12s", STRATEGY_NAMES[t.pool[a]]);
+        for (unsigned int b = 0; b < nStrategies; ++b) {
+            if (a == b || pair_games[a][b] == 0)
+                printf(" %12s", "-");
+            else
+                printf(" %12.4f", (double)pair_wins[a][b] / pair_games[a][b]);
+        }
+        printf("\n");
+    }
+
+    // Cleanup
+    free(t.lineups);
+    free(t.winner);
+    free(t.states);
+    BoardInfo_free(&binfo);
+    return 0;
+}